@@ -4,7 +4,7 @@
 #include "audio.hpp"
 #include "swarm.hpp"
 
-Mix_Chunk *buzz_wav[bee_t::k_state_count];
+Mix_Chunk *buzz_wav[bees_t::k_state_count];
 const char* wavfile_names[] =
 {
 	"res/wavfiles/swarm_base.wav",
@@ -28,13 +28,13 @@ bool audio_initialize()
 		SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Couldn't initialize audio mixer: %s", Mix_GetError());
 	}
 
-	success = Mix_AllocateChannels(bee_t::k_state_count);
+	success = Mix_AllocateChannels(bees_t::k_state_count);
 	if(success < 0)
 	{
 		SDL_LogError(SDL_LOG_CATEGORY_AUDIO, "Couldn't allocate channels: %s", Mix_GetError());
 	}
 
-	for(int i=0; i<bee_t::k_state_count; i++)
+	for(int i=0; i<bees_t::k_state_count; i++)
 	{
 		buzz_wav[i]= Mix_LoadWAV(wavfile_names[i]);
 	}
@@ -51,7 +51,7 @@ bool audio_initialize()
 
 void audio_dispose()
 {
-	for(int i=0; i<bee_t::k_state_count; i++)
+	for(int i=0; i<bees_t::k_state_count; i++)
 	{
 		if (buzz_wav[i])
 		{
@@ -66,13 +66,13 @@ void audio_dispose()
 	}
 }
 
-void audio_render(const swarm_t &swarm)
+void audio_render(const swarm_frame_t &swarm)
 {
 	float mix_volume= 64.0f;
-	static float prev_volume[bee_t::k_state_count];
-	static float new_volume[bee_t::k_state_count];
+	static float prev_volume[bees_t::k_state_count];
+	static float new_volume[bees_t::k_state_count];
 
-	for (int i=0; i<bee_t::k_state_count; i++)
+	for (int i=0; i<bees_t::k_state_count; i++)
 	{
 		if(i==0) // _idle
 		{
@@ -97,7 +97,7 @@ void audio_render(const swarm_t &swarm)
 		{
 			Mix_PlayChannel(i, buzz_wav[i], -1);
 		}
-		for (int i=0; i<bee_t::k_state_count; i++)
+		for (int i=0; i<bees_t::k_state_count; i++)
 		{
 			prev_volume[i]= new_volume[i];
 		}
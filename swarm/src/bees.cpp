@@ -0,0 +1,146 @@
+#include <cassert>
+#include <cmath>
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "bees.hpp"
+#include "config.hpp"
+#include "constants.hpp"
+
+const int k_lane_count= 8; // bees integrated per kernel iteration
+
+// wrap into [minimum, minimum+period) without looping
+inline float bees_wrap(float value, float minimum, float period)
+{
+	return value - period*std::floor((value-minimum)/period);
+}
+
+#if CV_SIMD128
+inline cv::v_float32x4 bees_wrap(const cv::v_float32x4 &value, float minimum, float period)
+{
+	cv::v_float32x4 turns= cv::v_cvt_f32(cv::v_floor((value-cv::v_setall_f32(minimum))*cv::v_setall_f32(1.0f/period)));
+	return value - turns*cv::v_setall_f32(period);
+}
+
+// cephes style sinf/cosf: reduce to [-pi/4, pi/4] around the nearest quadrant, then fix up by quadrant
+inline void bees_sincos(const cv::v_float32x4 &angle, cv::v_float32x4 &sine, cv::v_float32x4 &cosine)
+{
+	cv::v_int32x4 quadrant= cv::v_round(angle*cv::v_setall_f32(0.63661977f));
+	cv::v_float32x4 q= cv::v_cvt_f32(quadrant);
+	cv::v_float32x4 r= angle - q*cv::v_setall_f32(1.5703125f);
+	r= r - q*cv::v_setall_f32(4.8375129699707031e-4f);
+	r= r - q*cv::v_setall_f32(7.5497899548918821e-8f);
+
+	cv::v_float32x4 r2= r*r;
+	cv::v_float32x4 s= cv::v_setall_f32(-1.9515295891e-4f);
+	s= cv::v_fma(s, r2, cv::v_setall_f32(8.3321608736e-3f));
+	s= cv::v_fma(s, r2, cv::v_setall_f32(-1.6666654611e-1f));
+	s= cv::v_fma(s*r2, r, r);
+
+	cv::v_float32x4 c= cv::v_setall_f32(2.443315711809948e-5f);
+	c= cv::v_fma(c, r2, cv::v_setall_f32(-1.388731625493765e-3f));
+	c= cv::v_fma(c, r2, cv::v_setall_f32(4.166664568298827e-2f));
+	c= cv::v_fma(c, r2*r2, cv::v_setall_f32(1.0f) - cv::v_setall_f32(0.5f)*r2);
+
+	cv::v_int32x4 one= cv::v_setall_s32(1);
+	cv::v_int32x4 two= cv::v_setall_s32(2);
+	cv::v_float32x4 zero= cv::v_setzero_f32();
+	cv::v_float32x4 swap= cv::v_reinterpret_as_f32((quadrant & one)==one);
+	cv::v_float32x4 sine_negative= cv::v_reinterpret_as_f32((quadrant & two)==two);
+	cv::v_float32x4 cosine_negative= cv::v_reinterpret_as_f32(((quadrant+one) & two)==two);
+
+	sine= cv::v_select(swap, c, s);
+	cosine= cv::v_select(swap, s, c);
+	sine= cv::v_select(sine_negative, zero-sine, sine);
+	cosine= cv::v_select(cosine_negative, zero-cosine, cosine);
+}
+#endif
+
+// scratch[index]= values[order[index]], then swap the result in
+template <class value_t> static void bees_gather(std::vector<value_t> &values, std::vector<value_t> &scratch, const std::vector<int> &order)
+{
+	scratch.resize(values.size());
+	for (int index= 0; index<order.size(); index++)
+	{
+		scratch[index]= values[order[index]];
+	}
+	values.swap(scratch);
+}
+
+bees_t::bees_t(): count(0), order_generation(0), next_id(0)
+{
+}
+
+void bees_t::resize(int count)
+{
+	for (int bee_index= this->count; bee_index<count; bee_index++)
+	{
+		id.push_back(next_id++);
+	}
+	this->count= count;
+	id.resize(count);
+	x.resize(count);
+	y.resize(count);
+	facing.resize(count);
+	speed.resize(count);
+	spin.resize(count);
+	timer.resize(count);
+	state.resize(count);
+}
+
+void bees_t::permute(const std::vector<int> &order)
+{
+	assert(order.size()==count);
+
+	bees_gather(id, int_scratch, order);
+	bees_gather(x, float_scratch, order);
+	bees_gather(y, float_scratch, order);
+	bees_gather(facing, float_scratch, order);
+	bees_gather(speed, float_scratch, order);
+	bees_gather(spin, float_scratch, order);
+	bees_gather(timer, float_scratch, order);
+	bees_gather(state, state_scratch, order);
+	order_generation++;
+}
+
+void bees_t::integrate(int begin, int end)
+{
+	const float width_period= g_config.simulation_width+2.0f*k_bee_radius;
+	const float height_period= g_config.simulation_height+2.0f*k_bee_radius;
+	float *xs= x.data();
+	float *ys= y.data();
+	float *facings= facing.data();
+	const float *speeds= speed.data();
+	const float *spins= spin.data();
+	int index= begin;
+
+	#if CV_SIMD128
+	{
+		const int k_width= cv::v_float32x4::nlanes;
+		cv::v_float32x4 dt= cv::v_setall_f32(k_dt);
+
+		for (; index+k_lane_count<=end; index+= k_lane_count)
+		{
+			for (int lane= index; lane<index+k_lane_count; lane+= k_width)
+			{
+				cv::v_float32x4 facing= cv::v_load(facings+lane);
+				cv::v_float32x4 distance= cv::v_load(speeds+lane)*dt;
+				cv::v_float32x4 sine, cosine;
+
+				bees_sincos(facing, sine, cosine);
+				cv::v_store(xs+lane, bees_wrap(cv::v_fma(distance, cosine, cv::v_load(xs+lane)), -k_bee_radius, width_period));
+				cv::v_store(ys+lane, bees_wrap(cv::v_fma(distance, sine, cv::v_load(ys+lane)), -k_bee_radius, height_period));
+				cv::v_store(facings+lane, bees_wrap(cv::v_fma(cv::v_load(spins+lane), dt, facing), 0.0f, k_tau));
+			}
+		}
+	}
+	#endif
+
+	// scalar tail, or everything when there is no SIMD support
+	for (; index<end; index++)
+	{
+		xs[index]= bees_wrap(xs[index]+speeds[index]*std::cos(facings[index])*k_dt, -k_bee_radius, width_period);
+		ys[index]= bees_wrap(ys[index]+speeds[index]*std::sin(facings[index])*k_dt, -k_bee_radius, height_period);
+		facings[index]= bees_wrap(facings[index]+spins[index]*k_dt, 0.0f, k_tau);
+	}
+}
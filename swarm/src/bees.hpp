@@ -0,0 +1,46 @@
+#ifndef bees_hpp
+#define bees_hpp
+
+#include <cstdint>
+#include <vector>
+
+// structure-of-arrays bee storage, one array per field so per-bee passes stream through memory
+class bees_t
+{
+public:
+	enum state_t
+	{
+		_idle,
+		_crawling,
+		_flying,
+		k_state_count
+	};
+
+	bees_t();
+
+	void resize(int count);
+
+	// reorders every array so index i holds the bee that was at order[i], ids follow their bees
+	void permute(const std::vector<int> &order);
+
+	// advance position and facing of bees [begin, end) by one time step
+	void integrate(int begin, int end);
+
+	int count;
+	int order_generation; // bumped by permute, indices from an older generation name other bees
+	std::vector<int> id; // stable across permutes, e.g. for the sprite phase
+	std::vector<float> x, y;
+	std::vector<float> facing;
+	std::vector<float> speed;
+	std::vector<float> spin;
+	std::vector<float> timer;
+	std::vector<uint8_t> state;
+
+private:
+	int next_id;
+	std::vector<float> float_scratch;
+	std::vector<int> int_scratch;
+	std::vector<uint8_t> state_scratch;
+};
+
+#endif /* bees_hpp */
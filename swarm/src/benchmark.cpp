@@ -0,0 +1,378 @@
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <SDL_log.h>
+
+#include "benchmark.hpp"
+#include "camera.hpp"
+#include "config.hpp"
+#include "constants.hpp"
+#include "random.hpp"
+#include "swarm.hpp"
+#include "timer.hpp"
+#include "workers.hpp"
+
+const uint64_t k_benchmark_seed= 1;
+const int k_benchmark_warmup_frames= 30;
+const int k_benchmark_minimum_frames= 120;
+const double k_benchmark_minimum_time= 1.0; // seconds per case
+
+static const int k_benchmark_bee_counts[]= {1000, 10000, 50000};
+static const int k_benchmark_bee_count_count= sizeof(k_benchmark_bee_counts)/sizeof(k_benchmark_bee_counts[0]);
+
+// heap allocations while benchmark_run counts them, from every operator new in the program and matrix buffers through the allocator below
+static std::atomic<int64_t> g_benchmark_allocations(0);
+static std::atomic<bool> g_benchmark_counting(false); // live runs only pay a relaxed load per allocation
+
+static void *benchmark_allocate(size_t size)
+{
+	void *memory= std::malloc(size>0 ? size : 1);
+
+	if (g_benchmark_counting.load(std::memory_order_relaxed)) g_benchmark_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (!memory) throw std::bad_alloc();
+
+	return memory;
+}
+
+void *operator new(size_t size)
+{
+	return benchmark_allocate(size);
+}
+
+void *operator new[](size_t size)
+{
+	return benchmark_allocate(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+	std::free(memory);
+}
+
+#if defined(__cpp_aligned_new)
+static void *benchmark_allocate_aligned(size_t size, std::align_val_t alignment)
+{
+	#if defined(_MSC_VER)
+	void *memory= _aligned_malloc(size>0 ? size : 1, static_cast<size_t>(alignment));
+	#else
+	void *memory= NULL;
+	if (posix_memalign(&memory, static_cast<size_t>(alignment), size>0 ? size : 1)!=0) memory= NULL;
+	#endif
+
+	if (g_benchmark_counting.load(std::memory_order_relaxed)) g_benchmark_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (!memory) throw std::bad_alloc();
+
+	return memory;
+}
+
+static void benchmark_free_aligned(void *memory)
+{
+	#if defined(_MSC_VER)
+	_aligned_free(memory);
+	#else
+	std::free(memory);
+	#endif
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+	return benchmark_allocate_aligned(size, alignment);
+}
+
+void *operator new[](size_t size, std::align_val_t alignment)
+{
+	return benchmark_allocate_aligned(size, alignment);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+	benchmark_free_aligned(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept
+{
+	benchmark_free_aligned(memory);
+}
+
+void operator delete(void *memory, size_t, std::align_val_t) noexcept
+{
+	benchmark_free_aligned(memory);
+}
+
+void operator delete[](void *memory, size_t, std::align_val_t) noexcept
+{
+	benchmark_free_aligned(memory);
+}
+#endif
+
+// counts cv::Mat buffers, which come from cv::fastMalloc rather than operator new
+class benchmark_allocator_t : public cv::MatAllocator
+{
+public:
+	benchmark_allocator_t(): allocator(cv::Mat::getStdAllocator()) {}
+
+	cv::UMatData *allocate(int dims, const int *sizes, int type, void *data, size_t *step, cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const
+	{
+		if (!data && g_benchmark_counting.load(std::memory_order_relaxed)) g_benchmark_allocations.fetch_add(1, std::memory_order_relaxed);
+		return allocator->allocate(dims, sizes, type, data, step, flags, usage_flags);
+	}
+
+	bool allocate(cv::UMatData *data, cv::AccessFlag access_flags, cv::UMatUsageFlags usage_flags) const
+	{
+		return allocator->allocate(data, access_flags, usage_flags);
+	}
+
+	void deallocate(cv::UMatData *data) const
+	{
+		allocator->deallocate(data);
+	}
+
+private:
+	cv::MatAllocator *allocator;
+};
+
+struct benchmark_input_t
+{
+	std::string name;
+	cv::Mat1b edge_frame;
+	edge_mask_t edge_mask;
+	cv::Mat1i edge_counts;
+};
+
+typedef std::function<void(int frame_index)> benchmark_frame_t;
+
+// runs frame until both the frame and time minimums are met, then prints one result line.
+// ns_per_bee is 0 for cases whose cost does not scale with the bees
+static void benchmark_case(const char *name, const char *input, int bee_count, bool per_bee, const benchmark_frame_t &frame)
+{
+	sdl_timer_t timer;
+	int frame_count= 0;
+	int64_t allocations;
+	double time;
+
+	for (int frame_index= 0; frame_index<k_benchmark_warmup_frames; frame_index++)
+	{
+		frame(frame_index);
+	}
+
+	allocations= g_benchmark_allocations.load();
+	timer.reset();
+	do
+	{
+		frame(k_benchmark_warmup_frames+frame_count);
+		frame_count++;
+	}
+	while (frame_count<k_benchmark_minimum_frames || !timer.passed(k_benchmark_minimum_time));
+	time= timer.elapsed();
+	allocations= g_benchmark_allocations.load()-allocations;
+
+	std::printf("{\"case\": \"%s\", \"input\": \"%s\", \"bees\": %d, \"workers\": %d, \"frames\": %d, \"ns_per_bee\": %.3f, \"frames_per_second\": %.1f, \"allocations_per_frame\": %.2f}\n",
+		name, input, bee_count, workers_count(), frame_count,
+		per_bee ? 1e9*time/frame_count/bee_count : 0.0,
+		frame_count/time,
+		static_cast<double>(allocations)/frame_count);
+	std::fflush(stdout);
+}
+
+static void benchmark_make_inputs(std::vector<benchmark_input_t> &inputs)
+{
+	const char *k_image_filepaths[]= {"res/title.bmp", "res/bevo.bmp"};
+	benchmark_input_t input;
+
+	// idle images, the edge maps the installation shows when nobody is around
+	for (int image_index= 0; image_index<2; image_index++)
+	{
+		cv::Mat image= cv::imread(k_image_filepaths[image_index], cv::IMREAD_GRAYSCALE);
+
+		if (image.empty())
+		{
+			SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Couldn't read %s, skipping it", k_image_filepaths[image_index]);
+			continue;
+		}
+		input.name= k_image_filepaths[image_index];
+		cv::resize(image, input.edge_frame, cv::Size(k_edge_width, k_edge_height), 0, 0, cv::INTER_NEAREST);
+		inputs.push_back(input);
+		input= benchmark_input_t();
+	}
+
+	// synthetic edges, concentric rings for lots of edge with gaps between
+	input.name= "rings";
+	input.edge_frame= cv::Mat1b::zeros(k_edge_height, k_edge_width);
+	for (int radius= 16; radius<k_edge_width; radius+= 24)
+	{
+		cv::circle(input.edge_frame, cv::Point(k_edge_width/2, k_edge_height/2), radius, cv::Scalar(255), 2);
+	}
+	inputs.push_back(input);
+
+	// and no edges at all, every bee flies
+	input= benchmark_input_t();
+	input.name= "empty";
+	input.edge_frame= cv::Mat1b::zeros(k_edge_height, k_edge_width);
+	inputs.push_back(input);
+
+	for (int input_index= 0; input_index<inputs.size(); input_index++)
+	{
+		inputs[input_index].edge_mask.pack(inputs[input_index].edge_frame);
+		camera_count_edges(inputs[input_index].edge_mask, inputs[input_index].edge_counts);
+	}
+}
+
+// a hand drawing a circle, one point per frame
+static command_t benchmark_peace_command(int frame_index)
+{
+	command_t command;
+	float angle= 0.05f*frame_index;
+
+	command.gesture= _gesture_peace;
+	command.confidence= 1.0f;
+	command.frame_age= 0.0f;
+	command.bounding_box= cv::Rect(
+		static_cast<int>(k_edge_width/2 + 0.3f*k_edge_height*std::cos(angle))-20,
+		static_cast<int>(k_edge_height/2 + 0.3f*k_edge_height*std::sin(angle))-20,
+		40, 40);
+
+	return command;
+}
+
+bool benchmark_run()
+{
+	static benchmark_allocator_t allocator;
+	std::vector<benchmark_input_t> inputs;
+	swarm_t swarm;
+
+	cv::Mat::setDefaultAllocator(&allocator);
+	g_benchmark_counting= true;
+	random_seed(k_benchmark_seed);
+	workers_initialize();
+	benchmark_make_inputs(inputs);
+
+	for (int bee_count_index= 0; bee_count_index<k_benchmark_bee_count_count; bee_count_index++)
+	{
+		int bee_count= k_benchmark_bee_counts[bee_count_index];
+		commands_t no_commands;
+
+		g_config.bee_count= bee_count;
+
+		// default mode, bee_update for every bee with flow steering off
+		for (int input_index= 0; input_index<inputs.size(); input_index++)
+		{
+			const benchmark_input_t &input= inputs[input_index];
+
+			swarm.reset();
+			swarm.flow_active= false;
+			benchmark_case("update", input.name.c_str(), bee_count, true, [&](int)
+			{
+				swarm.update(input.edge_mask, input.edge_counts, no_commands);
+			});
+
+			// the flow field block on its own, from the landed state the update above left
+			swarm.flow_active= true;
+			benchmark_case("flow", input.name.c_str(), bee_count, false, [&](int)
+			{
+				swarm.update_flow(input.edge_mask, input.edge_counts);
+			});
+		}
+
+		// drawing mode, the canvas grows along a circle
+		{
+			const benchmark_input_t &input= inputs.back();
+			commands_t commands(1);
+
+			swarm.reset();
+			benchmark_case("draw_update", "circle", bee_count, true, [&](int frame_index)
+			{
+				commands[0]= benchmark_peace_command(frame_index);
+				swarm.update(input.edge_mask, input.edge_counts, commands);
+			});
+
+			// the force field alone, the circle grows by a stroke pixel per frame so there is always a dirty rectangle to refilter
+			benchmark_case("force", "circle", bee_count, false, [&](int frame_index)
+			{
+				float angle= 0.05f*frame_index;
+				int x= static_cast<int>(swarm.canvas.cols/2 + 0.3f*swarm.canvas.rows*std::cos(angle)) & ~1; // update_force samples even pixels
+				int y= static_cast<int>(swarm.canvas.rows/2 + 0.3f*swarm.canvas.rows*std::sin(angle)) & ~1;
+
+				swarm.canvas.draw(y, x);
+				swarm.canvas.advance();
+				swarm.update_force(swarm.canvas, swarm.landed);
+			});
+		}
+
+		// palm mode, every bee steers toward the hand
+		{
+			const benchmark_input_t &input= inputs.back();
+			commands_t commands(1);
+
+			commands[0].gesture= _gesture_palm;
+			commands[0].confidence= 1.0f;
+			commands[0].bounding_box= cv::Rect(k_edge_width/2-40, k_edge_height/2-40, 80, 80);
+			swarm.reset();
+			benchmark_case("palm_update", "center", bee_count, true, [&](int)
+			{
+				swarm.update(input.edge_mask, input.edge_counts, commands);
+			});
+		}
+	}
+
+	// camera processing does not depend on the bees
+	for (int input_index= 0; input_index<inputs.size(); input_index++)
+	{
+		cv::Mat3b video_frame(k_camera_height, k_camera_width, cv::Vec3b(0, 0, 0));
+		cv::Mat1w depth_frame(k_camera_height, k_camera_width, static_cast<uint16_t>(k_depth_threshold/2));
+		cv::Mat3b edge_color;
+		edge_extractor_t edge_extractor;
+		edge_mask_t edge_mask;
+
+		// the edge map as a picture, so canny has something to find
+		cv::cvtColor(255-inputs[input_index].edge_frame, edge_color, cv::COLOR_GRAY2BGR);
+		edge_color.copyTo(video_frame(cv::Rect(k_edge_x, k_edge_y, k_edge_width, k_edge_height)));
+
+		// the path the camera stage runs, straight to the mask
+		benchmark_case("camera_process_mask", inputs[input_index].name.c_str(), 0, false, [&](int)
+		{
+			edge_extractor.process_mask(video_frame, depth_frame, edge_mask);
+		});
+
+		// packing the mask and counting the cells
+		cv::Mat1i edge_counts;
+
+		benchmark_case("camera_count_edges", inputs[input_index].name.c_str(), 0, false, [&](int)
+		{
+			edge_mask.pack(inputs[input_index].edge_frame);
+			camera_count_edges(edge_mask, edge_counts);
+		});
+	}
+
+	workers_dispose();
+	g_benchmark_counting= false;
+	cv::Mat::setDefaultAllocator(NULL);
+
+	return true;
+}
@@ -0,0 +1,7 @@
+#ifndef benchmark_hpp
+#define benchmark_hpp
+
+// times the swarm hot paths on canned inputs and prints one json object per case to stdout
+bool benchmark_run();
+
+#endif /* benchmark_hpp */
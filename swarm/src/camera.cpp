@@ -1,36 +1,99 @@
+#include <atomic>
 #include <cassert>
-#include <cstring>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
 #include <mutex>
 #include <thread>
 
 #include <libfreenect.h>
 #include <opencv2/imgproc.hpp>
 #include <SDL_log.h>
+#include <SDL_timer.h>
 
 #include "camera.hpp"
+#include "config.hpp"
 #include "constants.hpp"
+#include "exchange.hpp"
+#include "trace.hpp"
 
 static void kinect_thread_function();
 static void kinect_video_callback(freenect_device *device, void *buffer, uint32_t timestamp);
 static void kinect_depth_callback(freenect_device *device, void *buffer, uint32_t timestamp);
 
-static void camera_process_frame(cv::Mat3b &video_frame, cv::Mat1w &depth_frame, cv::Mat1b &edge_frame);
-
 static freenect_context *g_kinect_context= NULL;
 static freenect_device *g_kinect_device= NULL;
 
 static bool g_kinect_thread_run= false;
 static std::thread *g_kinect_thread= NULL;
 
-static std::mutex g_frame_mutex;
-static uint8_t g_video_frame[k_camera_width*k_camera_height*3]= {0};
-static uint16_t g_depth_frame[k_camera_width*k_camera_height]= {0};
+static const int k_edge_margin= 32; // columns on either side without depth data
+
+static const int k_camera_set_count= 5; // pinned by the gesture thread and both director frames, plus latest and the one being filled
+static const int k_camera_buffer_count= k_camera_set_count+2; // per stream, every set can look held at once (a failed pin recheck holds one briefly), plus one waiting for its pair and one to write
+static const int k_camera_video_bytes= k_camera_width*k_camera_height*3;
+static const int k_camera_depth_bytes= k_camera_width*k_camera_height*sizeof(uint16_t);
+static const int32_t k_camera_pair_tolerance= 1000000; // timestamp ticks, about half a 30 Hz frame of the kinect's 60 MHz clock
+
+// a video frame and the depth frame captured with it, the only thing readers ever see
+struct camera_set_t
+{
+	int video_buffer, depth_buffer;
+	uint32_t video_timestamp, depth_timestamp;
+	uint64_t arrival_counter; // when the first of the two arrived
+	int frame_count;
+};
+
+// a frame that arrived and waits for its partner from the other stream
+struct camera_pending_t
+{
+	int buffer; // -1 when there is none
+	uint32_t timestamp;
+	uint64_t arrival_counter;
+};
+
+static void kinect_frame_arrived(bool video, int buffer, uint32_t timestamp);
+static int kinect_free_buffer(bool video);
+
+// libfreenect demosaics and registers straight into these buffers and the rest of the app reads them in place,
+// only set indices change hands. set 0 starts out published and black, buffers 1 are handed to libfreenect first
+static cv::Mat3b g_video_buffers[k_camera_buffer_count];
+static cv::Mat1w g_depth_buffers[k_camera_buffer_count];
+static camera_set_t g_camera_sets[k_camera_set_count];
+static exchange_t<k_camera_set_count> g_camera_exchange;
+
+// kinect thread only
+static int g_video_write_buffer= 1;
+static int g_depth_write_buffer= 1;
+static camera_pending_t g_pending_video= {-1, 0, 0};
+static camera_pending_t g_pending_depth= {-1, 0, 0};
 static int g_frame_count= 0;
 
+// only to wake up waiters, the sets themselves are handed over without it
+static std::mutex g_camera_wait_mutex;
+static std::condition_variable g_camera_published;
+
+// read and reset by camera_log_statistics
+static std::atomic<int> g_paired_count(0);
+static std::atomic<int> g_dropped_count(0);
+static std::atomic<int> g_consumed_count(0);
+static std::atomic<int64_t> g_latency_total(0); // microseconds
+static std::atomic<int64_t> g_latency_maximum(0);
+
+static edge_extractor_t g_edge_extractor; // camera task only
+
 bool camera_initialize()
 {
 	bool success= false;
 
+	for (int buffer= 0; buffer<k_camera_buffer_count; buffer++)
+	{
+		g_video_buffers[buffer]= cv::Mat3b::zeros(k_camera_height, k_camera_width);
+		g_depth_buffers[buffer]= cv::Mat1w::zeros(k_camera_height, k_camera_width);
+		assert(g_video_buffers[buffer].isContinuous() && g_depth_buffers[buffer].isContinuous());
+	}
+	g_camera_sets[0].arrival_counter= SDL_GetPerformanceCounter();
+
 	if (freenect_init(&g_kinect_context, NULL)==0)
 	{
 		freenect_device_attributes *device_attributes= NULL;
@@ -53,10 +116,11 @@ bool camera_initialize()
 					assert(video_mode.video_format==FREENECT_VIDEO_RGB);
 					assert(video_mode.width==k_camera_width);
 					assert(video_mode.height==k_camera_height);
-					assert(video_mode.bytes==sizeof(g_video_frame));
+					assert(video_mode.bytes==k_camera_video_bytes);
 					#endif
 
 					freenect_set_video_callback(g_kinect_device, kinect_video_callback);
+					freenect_set_video_buffer(g_kinect_device, g_video_buffers[g_video_write_buffer].data);
 
 					if (freenect_set_depth_mode(g_kinect_device, freenect_find_depth_mode(FREENECT_RESOLUTION_MEDIUM, FREENECT_DEPTH_REGISTERED))==0)
 					{
@@ -66,10 +130,11 @@ bool camera_initialize()
 						assert(depth_mode.depth_format==FREENECT_DEPTH_REGISTERED);
 						assert(depth_mode.width==k_camera_width);
 						assert(depth_mode.height==k_camera_height);
-						assert(depth_mode.bytes==sizeof(g_depth_frame));
+						assert(depth_mode.bytes==k_camera_depth_bytes);
 						#endif
 
 						freenect_set_depth_callback(g_kinect_device, kinect_depth_callback);
+						freenect_set_depth_buffer(g_kinect_device, g_depth_buffers[g_depth_write_buffer].data);
 
 						g_kinect_thread_run= true;
 						g_kinect_thread= new std::thread(kinect_thread_function);
@@ -108,6 +173,8 @@ bool camera_initialize()
 
 static void kinect_thread_function()
 {
+	trace_thread("kinect");
+
 	while (freenect_set_led(g_kinect_device, LED_GREEN)!=0)
 	{
 		SDL_LogWarn(SDL_LOG_CATEGORY_VIDEO, "Couldn't set kinect LED");
@@ -151,23 +218,117 @@ static void kinect_thread_function()
 	}
 }
 
+// the frame is already in the write buffer, pair it and point libfreenect at a free one
 static void kinect_video_callback(freenect_device *device, void *buffer, uint32_t timestamp)
 {
-	g_frame_mutex.lock();
-	memcpy(&g_video_frame, buffer, sizeof(g_video_frame));
-	g_frame_count++;
-	g_frame_mutex.unlock();
+	assert(buffer==g_video_buffers[g_video_write_buffer].data);
+	trace_instant("video frame", timestamp);
 
-	SDL_LogInfo(SDL_LOG_CATEGORY_VIDEO, "Received video frame at timestamp: %u", timestamp);
+	kinect_frame_arrived(true, g_video_write_buffer, timestamp);
+	g_video_write_buffer= kinect_free_buffer(true);
+	freenect_set_video_buffer(device, g_video_buffers[g_video_write_buffer].data);
 }
 
 static void kinect_depth_callback(freenect_device *device, void *buffer, uint32_t timestamp)
 {
-	g_frame_mutex.lock();
-	memcpy(&g_depth_frame, buffer, sizeof(g_depth_frame));
-	g_frame_mutex.unlock();
+	assert(buffer==g_depth_buffers[g_depth_write_buffer].data);
+	trace_instant("depth frame", timestamp);
+
+	kinect_frame_arrived(false, g_depth_write_buffer, timestamp);
+	g_depth_write_buffer= kinect_free_buffer(false);
+	freenect_set_depth_buffer(device, g_depth_buffers[g_depth_write_buffer].data);
+}
+
+// publishes a set when the other stream has a frame within the tolerance, otherwise the frame waits
+// for its partner. a frame that can no longer be matched is dropped rather than paired with the wrong one
+static void kinect_frame_arrived(bool video, int buffer, uint32_t timestamp)
+{
+	camera_pending_t &own= video ? g_pending_video : g_pending_depth;
+	camera_pending_t &other= video ? g_pending_depth : g_pending_video;
+	uint64_t counter= SDL_GetPerformanceCounter();
+
+	if (other.buffer>=0)
+	{
+		int32_t difference= static_cast<int32_t>(timestamp-other.timestamp); // wraps with the counter
+
+		if (std::abs(difference)<=k_camera_pair_tolerance)
+		{
+			int set_index= g_camera_exchange.acquire();
+
+			if (set_index>=0)
+			{
+				camera_set_t &set= g_camera_sets[set_index];
+
+				set.video_buffer= video ? buffer : other.buffer;
+				set.depth_buffer= video ? other.buffer : buffer;
+				set.video_timestamp= video ? timestamp : other.timestamp;
+				set.depth_timestamp= video ? other.timestamp : timestamp;
+				set.arrival_counter= other.arrival_counter;
+				set.frame_count= ++g_frame_count;
+				g_camera_exchange.publish(set_index);
+				g_paired_count++;
+
+				// taking the mutex makes sure a waiter is either asleep or will see the new set
+				g_camera_wait_mutex.lock();
+				g_camera_wait_mutex.unlock();
+				g_camera_published.notify_all();
+			}
+			else
+			{
+				SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Dropped frame set, every set is pinned");
+				g_dropped_count+= 2;
+			}
+			other.buffer= -1;
+			if (own.buffer>=0)
+			{
+				own.buffer= -1;
+				g_dropped_count++;
+			}
+			return;
+		}
+
+		// the other stream's frame is older than anything still to come from this one
+		if (difference>0)
+		{
+			other.buffer= -1;
+			g_dropped_count++;
+		}
+	}
+
+	if (own.buffer>=0)
+	{
+		g_dropped_count++;
+	}
+	own.buffer= buffer;
+	own.timestamp= timestamp;
+	own.arrival_counter= counter;
+}
+
+// a buffer of the stream that no held set, waiting frame or write target uses
+static int kinect_free_buffer(bool video)
+{
+	const camera_pending_t &pending= video ? g_pending_video : g_pending_depth;
+	bool used[k_camera_buffer_count]= {false};
+
+	for (int set_index= 0; set_index<k_camera_set_count; set_index++)
+	{
+		if (g_camera_exchange.held(set_index))
+		{
+			used[video ? g_camera_sets[set_index].video_buffer : g_camera_sets[set_index].depth_buffer]= true;
+		}
+	}
+	if (pending.buffer>=0)
+	{
+		used[pending.buffer]= true;
+	}
+
+	for (int buffer= 0; buffer<k_camera_buffer_count; buffer++)
+	{
+		if (!used[buffer]) return buffer;
+	}
 
-	SDL_LogInfo(SDL_LOG_CATEGORY_VIDEO, "Received depth frame at timestamp: %u", timestamp);
+	assert(false); // k_camera_buffer_count covers every way a buffer can be in use, so one is always free
+	return video ? g_video_write_buffer : g_depth_write_buffer;
 }
 
 void camera_dispose()
@@ -193,80 +354,150 @@ void camera_dispose()
 	}
 }
 
-void camera_peek_video_frame(
-	cv::Mat3b &video_frame)
+camera_frame_t::camera_frame_t(): frame_count(0), video_timestamp(0), depth_timestamp(0), latency(0.0), set(-1)
 {
-	video_frame.create(k_camera_height, k_camera_width);
-	assert(video_frame.isContinuous());
-	assert(video_frame.dataend-video_frame.datastart==sizeof(g_video_frame));
-
-	g_frame_mutex.lock();
-	std::memcpy(video_frame.data, g_video_frame, sizeof(g_video_frame));
-	g_frame_mutex.unlock();
 }
 
-int camera_consume_full_frame(
-	cv::Mat3b &video_frame,
-	cv::Mat1w &depth_frame,
-	cv::Mat1b &edge_frame)
+static void camera_pin_set(
+	camera_frame_t &frame)
 {
-	int frame_count;
+	frame.set= g_camera_exchange.pin();
 
-	video_frame.create(k_camera_height, k_camera_width);
-	assert(video_frame.isContinuous());
-	assert(video_frame.dataend-video_frame.datastart==sizeof(g_video_frame));
+	const camera_set_t &set= g_camera_sets[frame.set];
 
-	depth_frame.create(k_camera_height, k_camera_width);
-	assert(depth_frame.isContinuous());
-	assert(depth_frame.dataend-depth_frame.datastart==sizeof(g_depth_frame));
+	frame.video_frame= g_video_buffers[set.video_buffer];
+	frame.depth_frame= g_depth_buffers[set.depth_buffer];
+	frame.frame_count= set.frame_count;
+	frame.video_timestamp= set.video_timestamp;
+	frame.depth_timestamp= set.depth_timestamp;
+	frame.latency= static_cast<double>(SDL_GetPerformanceCounter()-set.arrival_counter)/SDL_GetPerformanceFrequency();
+}
 
-	g_frame_mutex.lock();
-	std::memcpy(video_frame.data, g_video_frame, sizeof(g_video_frame));
-	std::memcpy(depth_frame.data, g_depth_frame, sizeof(g_depth_frame));
-	frame_count= g_frame_count;
-	g_frame_mutex.unlock();
+void camera_peek_video_frame(
+	camera_frame_t &frame)
+{
+	camera_release_frame(frame);
+	camera_pin_set(frame);
+}
+
+int camera_latest_frame_count()
+{
+	int set_index= g_camera_exchange.pin();
+	int frame_count= g_camera_sets[set_index].frame_count;
 
-	camera_process_frame(video_frame, depth_frame, edge_frame);
+	g_camera_exchange.unpin(set_index);
 
 	return frame_count;
 }
 
-static void camera_process_frame(
-	cv::Mat3b &video_frame,
-	cv::Mat1w &depth_frame,
-	cv::Mat1b &edge_frame)
+bool camera_wait_frame(
+	int seen_frame_count,
+	double timeout)
 {
-	cv::Mat gray_frame, canny_frame, blurred_frame;
+	std::unique_lock<std::mutex> lock(g_camera_wait_mutex);
 
-	// convert to grayscale 
-	cv::cvtColor(video_frame(cv::Rect(k_edge_x, k_edge_y, k_edge_width, k_edge_height)), gray_frame, cv::COLOR_BGR2GRAY);
+	return g_camera_published.wait_for(lock, std::chrono::duration<double>(timeout), [&]{ return camera_latest_frame_count()!=seen_frame_count; });
+}
 
-	// detect edges using Canny algorithm
-	cv::Canny(gray_frame, canny_frame, 100, 200); // last two parameters are low threshold and high threshold
+int camera_consume_full_frame(
+	camera_frame_t &frame,
+	cv::Mat1b &edge_frame,
+	edge_mask_t &edge_mask,
+	cv::Mat1i &edge_counts,
+	bool unpack_edge_frame)
+{
+	camera_release_frame(frame);
+	camera_pin_set(frame);
 
-	// thicken the resulting edges
-	cv::GaussianBlur(canny_frame, blurred_frame, cv::Size(3, 3), 2); // last two parameters are window and sigma
+	int64_t latency= static_cast<int64_t>(1e6*frame.latency);
+	int64_t maximum= g_latency_maximum.load();
 
-	// remove edges that are past the depth threshold or outside the vertical margins of the available depth data
-	edge_frame.create(k_edge_height, k_edge_width);
-	cv::Mat1w clipped_depth_frame= depth_frame(cv::Rect(k_edge_x, k_edge_y, k_edge_width, k_edge_height));
-	for (int i= 0; i<clipped_depth_frame.rows; i++)
+	g_consumed_count++;
+	g_latency_total+= latency;
+	while (latency>maximum && !g_latency_maximum.compare_exchange_weak(maximum, latency));
+
+	// the mask is what the swarm uses, the edge frame only feeds the debug view and the recorder
+	g_edge_extractor.process_mask(frame.video_frame, frame.depth_frame, edge_mask);
+	if (unpack_edge_frame)
+	{
+		edge_mask.unpack(edge_frame);
+	}
+	else
 	{
-		int j;
+		edge_frame.release();
+	}
+	camera_count_edges(edge_mask, edge_counts);
 
-		for (j= 0; j<32; j++)
-		{
-			edge_frame(i, j)= 0;
-		}
+	return frame.frame_count;
+}
 
-		for (; j<clipped_depth_frame.cols-32; j++)
-		{
-			edge_frame(i, j)= clipped_depth_frame(i, j)<k_depth_threshold ? blurred_frame.at<uint8_t>(i, j) : 0;
-		}
+void camera_release_frame(
+	camera_frame_t &frame)
+{
+	if (frame.set>=0)
+	{
+		g_camera_exchange.unpin(frame.set);
+		frame.set= -1;
+		frame.video_frame.release();
+		frame.depth_frame.release();
+	}
+}
 
-		for (; j<clipped_depth_frame.cols; j++)
+void camera_log_statistics()
+{
+	int paired= g_paired_count.exchange(0);
+	int dropped= g_dropped_count.exchange(0);
+	int consumed= g_consumed_count.exchange(0);
+	int64_t latency_total= g_latency_total.exchange(0);
+	int64_t latency_maximum= g_latency_maximum.exchange(0);
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Camera paired %d frame sets, dropped %d unmatched frames, latency %.2f ms average, %.2f ms worst",
+		paired, dropped, consumed>0 ? 1e-3*latency_total/consumed : 0.0, 1e-3*latency_maximum);
+}
+
+void camera_count_edges(
+	const edge_mask_t &edge_mask,
+	cv::Mat1i &edge_counts)
+{
+	edge_counts.create(g_config.field_height, g_config.field_width);
+	edge_counts.setTo(0);
+
+	int cell_width= edge_mask.cols/edge_counts.cols;
+	int cell_height= edge_mask.rows/edge_counts.rows;
+
+	for (int y= 0; y<edge_counts.rows*cell_height; y++)
+	{
+		int *count= edge_counts.ptr<int>(y/cell_height);
+
+		for (int x= 0; x<edge_counts.cols; x++)
 		{
-			edge_frame(i, j)= 0;
+			count[x]+= edge_mask.count(y, x*cell_width, (x+1)*cell_width);
 		}
 	}
 }
+
+void edge_extractor_t::process_mask(
+	const cv::Mat3b &video_frame,
+	const cv::Mat1w &depth_frame,
+	edge_mask_t &edge_mask)
+{
+	cv::cvtColor(video_frame(cv::Rect(k_edge_x, k_edge_y, k_edge_width, k_edge_height)), gray_frame, cv::COLOR_BGR2GRAY);
+	cv::Canny(gray_frame, canny_frame, 100, 200); // last two parameters are low threshold and high threshold
+
+	// thicken the edges, a 3x3 blur only mattered as far as which pixels ended up nonzero, that is a 3x3 dilation
+	canny_mask.pack(canny_frame);
+	canny_mask.dilate(edge_mask);
+
+	// remove edges that are past the depth threshold or outside the vertical margins of the available depth data
+	mask_depth(depth_frame);
+	near_mask.pack(near_frame);
+	edge_mask.intersect(near_mask);
+}
+
+void edge_extractor_t::mask_depth(
+	const cv::Mat1w &depth_frame)
+{
+	cv::compare(depth_frame(cv::Rect(k_edge_x, k_edge_y, k_edge_width, k_edge_height)), cv::Scalar(k_depth_threshold), near_frame, cv::CMP_LT);
+	near_frame.colRange(0, k_edge_margin).setTo(0);
+	near_frame.colRange(k_edge_width-k_edge_margin, k_edge_width).setTo(0);
+}
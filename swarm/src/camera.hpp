@@ -3,10 +3,56 @@
 
 #include <opencv2/core.hpp>
 
+#include "mask.hpp"
+
 bool camera_initialize();
 void camera_dispose();
 
-void camera_peek_video_frame(cv::Mat3b &video_frame);
-int camera_consume_full_frame(cv::Mat3b &video_frame, cv::Mat1w &depth_frame, cv::Mat1b &edge_frame);
+// read only views of a video frame and the depth frame captured with it, matched by their kinect
+// timestamps. pinned in place until the frame is released or filled again
+struct camera_frame_t
+{
+	camera_frame_t();
+
+	cv::Mat3b video_frame;
+	cv::Mat1w depth_frame;
+	int frame_count;
+	uint32_t video_timestamp, depth_timestamp;
+	double latency; // seconds from the first of the pair arriving to it being pinned
+
+	int set; // -1 when nothing is pinned
+};
+
+// pins the latest frame set for its video
+void camera_peek_video_frame(camera_frame_t &frame);
+
+// frame_count of the latest frame set, to skip consuming one that was already seen
+int camera_latest_frame_count();
+
+// blocks until a frame set newer than seen_frame_count is published, false after timeout seconds without one
+bool camera_wait_frame(int seen_frame_count, double timeout);
+// edge_frame is only unpacked from the mask with unpack_edge_frame, and left empty otherwise
+int camera_consume_full_frame(camera_frame_t &frame, cv::Mat1b &edge_frame, edge_mask_t &edge_mask, cv::Mat1i &edge_counts, bool unpack_edge_frame);
+void camera_release_frame(camera_frame_t &frame);
+
+// sets paired, frames dropped without a partner and consume latency since the last call
+void camera_log_statistics();
+
+// edge detection with buffers kept from frame to frame, one per thread that uses it
+class edge_extractor_t
+{
+public:
+	// canny edges straight to bits, thickened by a 3x3 bit dilation, depth masks out the background
+	void process_mask(const cv::Mat3b &video_frame, const cv::Mat1w &depth_frame, edge_mask_t &edge_mask);
+
+private:
+	void mask_depth(const cv::Mat1w &depth_frame); // near_frame= 255 where the edges may be
+
+	cv::Mat1b gray_frame, canny_frame, near_frame;
+	edge_mask_t canny_mask, near_mask;
+};
+
+// counts the edge pixels under each field cell with popcounts over the packed mask
+void camera_count_edges(const edge_mask_t &edge_mask, cv::Mat1i &edge_counts);
 
 #endif /* camera_hpp */
@@ -0,0 +1,57 @@
+#include <climits>
+#include <cmath>
+
+#include "canvas.hpp"
+#include "constants.hpp"
+
+const float k_canvas_fade= 0.99f; // per fade period
+const float k_canvas_fade_period= 1.0f/60.0f; // seconds, independent of the simulation rate
+const float k_canvas_threshold= 0.01f; // faded below this a pixel is gone
+
+canvas_t::canvas_t(): rows(0), cols(0), step(0), lifetime(0), count(0)
+{
+}
+
+void canvas_t::initialize(int rows, int cols)
+{
+	this->rows= rows;
+	this->cols= cols;
+	step= 0;
+	count= 0;
+	lifetime= static_cast<int>(std::log(k_canvas_threshold)/std::log(k_canvas_fade)*k_canvas_fade_period/k_dt);
+	drawn_at= cv::Mat1i(rows, cols, INT_MIN/2);
+	expiring.assign(lifetime+1, std::vector<int>());
+}
+
+void canvas_t::advance()
+{
+	step++;
+
+	// pixels drawn lifetime+1 steps ago fade out now unless they were drawn again since
+	std::vector<int> &bucket= expiring[step%expiring.size()];
+	int expired_at= step-lifetime-1;
+	const int *drawn= drawn_at[0];
+
+	for (int index= 0; index<bucket.size(); index++)
+	{
+		if (drawn[bucket[index]]==expired_at)
+		{
+			count--;
+		}
+	}
+	bucket.clear();
+}
+
+void canvas_t::draw(int y, int x)
+{
+	int &drawn= drawn_at(y, x);
+
+	if (drawn==step) return;
+
+	if (drawn<step-lifetime)
+	{
+		count++;
+	}
+	drawn= step;
+	expiring[step%expiring.size()].push_back(y*cols+x);
+}
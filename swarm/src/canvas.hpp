@@ -0,0 +1,32 @@
+#ifndef canvas_hpp
+#define canvas_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+// strokes of the drawing mode. each pixel remembers the step it was last drawn on and fades
+// analytically from there, so nothing is touched per step except the pixels that expire
+class canvas_t
+{
+public:
+	canvas_t();
+
+	void initialize(int rows, int cols);
+	void advance(); // one simulation step of fading
+	void draw(int y, int x);
+
+	bool visible(int y, int x) const { return drawn_at(y, x)>=step-lifetime; }
+	int visible_count() const { return count; }
+
+	int rows, cols;
+
+private:
+	int step;
+	int lifetime; // steps a pixel stays visible after it was last drawn
+	int count;
+	cv::Mat1i drawn_at;
+	std::vector<std::vector<int>> expiring; // pixel indices drawn on each of the last lifetime+1 steps
+};
+
+#endif /* canvas_hpp */
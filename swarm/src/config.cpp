@@ -0,0 +1,177 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <SDL_log.h>
+
+#include "config.hpp"
+#include "constants.hpp"
+
+static const char *k_config_default_filepath= "res/swarm.cfg";
+static const int k_field_cell_size_minimum= 8; // the baseline 80x45 field, finer ones are untested
+
+static bool config_set(const std::string &key, const std::string &value);
+static bool config_load(const char *filepath, bool required);
+
+config_t g_config=
+{
+	10000, // bee_count
+	1920, 1080, // simulation_width, simulation_height
+	8, // field_cell_size
+	0, 0,
+	"", "", 0,
+	5, // gesture_detect_interval
+	0,
+	"swarm_trace.json"
+};
+
+struct config_entry_t
+{
+	const char *key;
+	int *value;
+	int minimum;
+	std::string *text; // instead of value for string settings
+};
+
+static const config_entry_t k_config_entries[]=
+{
+	{"bee_count", &g_config.bee_count, 1, NULL},
+	{"simulation_width", &g_config.simulation_width, 64, NULL},
+	{"simulation_height", &g_config.simulation_height, 64, NULL},
+	{"field_cell_size", &g_config.field_cell_size, k_field_cell_size_minimum, NULL},
+	{"record", NULL, 0, &g_config.record_filepath},
+	{"replay", NULL, 0, &g_config.replay_filepath},
+	{"replay_fast", &g_config.replay_fast, 0, NULL},
+	{"gesture_detect_interval", &g_config.gesture_detect_interval, 1, NULL},
+	{"benchmark", &g_config.benchmark, 0, NULL},
+	{"trace", NULL, 0, &g_config.trace_filepath}
+};
+static const int k_config_entry_count= sizeof(k_config_entries)/sizeof(k_config_entries[0]);
+
+bool config_initialize(int argc, char *argv[])
+{
+	const char *filepath= k_config_default_filepath;
+	bool required= false;
+	bool success= true;
+
+	for (int argument_index= 1; argument_index<argc; argument_index++)
+	{
+		if (std::strncmp(argv[argument_index], "--config=", 9)==0)
+		{
+			filepath= argv[argument_index]+9;
+			required= true;
+		}
+	}
+
+	success= config_load(filepath, required);
+
+	for (int argument_index= 1; argument_index<argc; argument_index++)
+	{
+		std::string argument= argv[argument_index];
+		size_t separator= argument.find('=');
+
+		if (argument.compare(0, 2, "--")!=0 || separator==std::string::npos)
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Expected --key=value, got %s", argument.c_str());
+			success= false;
+		}
+		else if (argument.compare(0, separator, "--config")!=0)
+		{
+			success= config_set(argument.substr(2, separator-2), argument.substr(separator+1)) && success;
+		}
+	}
+
+	g_config.field_width= k_edge_width/g_config.field_cell_size;
+	g_config.field_height= k_edge_height/g_config.field_cell_size;
+	if (g_config.field_width<1 || g_config.field_height<1)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "field_cell_size %d is larger than the edge frame", g_config.field_cell_size);
+		success= false;
+	}
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "%d bees, %dx%d simulation, %dx%d field",
+		g_config.bee_count, g_config.simulation_width, g_config.simulation_height, g_config.field_width, g_config.field_height);
+
+	return success;
+}
+
+static bool config_set(const std::string &key, const std::string &value)
+{
+	for (int entry_index= 0; entry_index<k_config_entry_count; entry_index++)
+	{
+		const config_entry_t &entry= k_config_entries[entry_index];
+
+		if (key==entry.key && entry.text)
+		{
+			*entry.text= value;
+			return true;
+		}
+		else if (key==entry.key)
+		{
+			char *end= NULL;
+			long number= std::strtol(value.c_str(), &end, 0);
+
+			if (end==value.c_str() || *end!='\0' || number<entry.minimum || number>INT_MAX)
+			{
+				SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Invalid %s: %s", key.c_str(), value.c_str());
+				return false;
+			}
+
+			*entry.value= static_cast<int>(number);
+			return true;
+		}
+	}
+
+	SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Unknown setting %s", key.c_str());
+	return false;
+}
+
+// one key = value per line, # starts a comment
+static bool config_load(const char *filepath, bool required)
+{
+	FILE *file= std::fopen(filepath, "r");
+	bool success= true;
+	char line[256];
+
+	if (!file)
+	{
+		if (required)
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't open config %s", filepath);
+		}
+		return !required;
+	}
+
+	while (std::fgets(line, sizeof(line), file))
+	{
+		std::string text= line;
+		size_t comment= text.find('#');
+		size_t separator;
+
+		if (comment!=std::string::npos) text.erase(comment);
+		text.erase(text.find_last_not_of(" \t\r\n")+1);
+		text.erase(0, text.find_first_not_of(" \t"));
+		if (text.empty()) continue;
+
+		separator= text.find('=');
+		if (separator==std::string::npos)
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Expected key= value in %s: %s", filepath, text.c_str());
+			success= false;
+			continue;
+		}
+
+		std::string key= text.substr(0, separator);
+		std::string value= text.substr(separator+1);
+
+		key.erase(key.find_last_not_of(" \t")+1);
+		value.erase(0, value.find_first_not_of(" \t"));
+		success= config_set(key, value) && success;
+	}
+
+	std::fclose(file);
+
+	return success;
+}
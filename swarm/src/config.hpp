@@ -0,0 +1,30 @@
+#ifndef config_hpp
+#define config_hpp
+
+#include <string>
+
+// per venue settings, read once at startup before anything is allocated from them
+struct config_t
+{
+	int bee_count;
+	int simulation_width, simulation_height; // also the window size, the projector resolution
+	int field_cell_size; // edge pixels per landed/flow cell side
+	int field_width, field_height; // derived from field_cell_size
+
+	std::string record_filepath; // log every frame the swarm consumes
+	std::string replay_filepath; // run from a recorded log instead of the camera and gestures
+	int replay_fast; // replay as fast as possible instead of at k_fps
+
+	int gesture_detect_interval; // camera frames per hand detection, the hands are tracked in between
+
+	int benchmark; // time the hot paths and exit, no window
+
+	std::string trace_filepath; // where r dumps the frame trace
+};
+
+extern config_t g_config;
+
+// reads res/swarm.cfg, or the file given by --config=, then applies --key=value arguments on top
+bool config_initialize(int argc, char *argv[]);
+
+#endif /* config_hpp */
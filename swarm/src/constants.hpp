@@ -1,8 +1,11 @@
 #ifndef constants_hpp
 #define constants_hpp
 
-const int k_fps= 60;
-const float k_dt= 1.0f/k_fps;
+const int k_fps= 60; // render rate, the projector refresh
+const int k_simulation_rate= 120; // fixed simulation steps per second
+const float k_dt= 1.0f/k_simulation_rate;
+
+const float k_tau= 6.2831853f;
 
 const int k_camera_width= 640;
 const int k_camera_height= 480;
@@ -15,12 +18,11 @@ const int k_edge_y= (k_camera_height-k_edge_height)/2;
 
 const int k_depth_threshold= 1500; // in millimeters
 
-const int k_simulation_width= 1920;
-const int k_simulation_height= 1080;
-
-const int k_bee_count= 10000;
+// simulation size, field size and bee count are per venue, see config.hpp
 const float k_bee_radius= 8.0f;
 
 const int k_seconds_before_idle= 10;
 
+const int k_worker_maximum= 64;
+
 #endif /* constants_hpp */
@@ -1,18 +1,29 @@
+#include <cstdlib>
+#include <ctime>
+
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
 #include <SDL_events.h>
+#include <SDL_stdinc.h>
 #include <SDL_log.h>
 
 #include "audio.hpp"
 #include "camera.hpp"
+#include "config.hpp"
 #include "constants.hpp"
 #include "director.hpp"
 #include "gesture.hpp"
 #include "graphics.hpp"
+#include "random.hpp"
+#include "replay.hpp"
+#include "simulation.hpp"
 #include "swarm.hpp"
+#include "tasks.hpp"
 #include "timer.hpp"
+#include "trace.hpp"
+#include "workers.hpp"
 
-static const double k_idle_maximum_image_distance= 0.01*k_edge_width*k_edge_height*UINT8_MAX;
+static const double k_idle_maximum_image_distance= 0.01*k_edge_width*k_edge_height; // in edge pixels
 
 static const char *k_idle_image_filepaths[]=
 {
@@ -27,7 +38,26 @@ static const int k_idle_image_count= sizeof(k_idle_image_filepaths)/sizeof(k_idl
 static const double k_title_time= 5.0;
 static const int k_title_image_index= 3;
 
+static const int k_frame_graph_thread_count= 2; // camera and audio can run at once
+static const double k_frame_graph_report_period= 10.0; // seconds between stage timing logs
+
+// camera input is double buffered, the camera task fills the next slot while the other stages show this one
+struct director_frame_t
+{
+	camera_frame_t camera;
+	cv::Mat1b edge_frame;
+	edge_mask_t edge_mask;
+	cv::Mat1i edge_counts;
+};
+
 static void director_idle_update(int num_gesture);
+static const cv::Mat1b &director_edge_frame(director_frame_t &frame);
+static void director_replay_frame();
+static void director_camera_task();
+static void director_gesture_task();
+static void director_swarm_task();
+static void director_render_task();
+static void director_audio_task();
 
 static bool g_running;
 static bool g_fullscreen;
@@ -35,25 +65,87 @@ static bool g_idle;
 static bool g_debug;
 static bool g_fps;
 
-static cv::Mat3b g_video_frame;
-static cv::Mat1w g_depth_frame;
-static cv::Mat1b g_edge_frame;
-static cv::Mat1b g_last_edge_frame;
+static director_frame_t g_frames[2];
+static int g_frame_index; // slot shown this frame
+static bool g_frame_fresh; // the camera task filled the other slot with a frame not seen before
+
+// what the simulation last got, so unchanged edges are not submitted again
+static const edge_mask_t *g_submitted_edge_mask;
+static int g_submitted_frame_count;
+static cv::Mat1i g_last_edge_counts;
+
+static task_graph_t g_frame_graph;
+static sdl_timer_t g_frame_graph_report_timer;
 
 static commands_t g_commands;
 
-static swarm_t g_swarm;
+static swarm_frame_t g_swarm_frame;
 
 static int g_idle_image_index;
-static cv::Mat g_idle_images[k_idle_image_count];
-static timer_t g_idle_timer;
+static cv::Mat1b g_idle_images[k_idle_image_count];
+static edge_mask_t g_idle_edge_masks[k_idle_image_count];
+static cv::Mat1i g_idle_edge_counts[k_idle_image_count];
+static sdl_timer_t g_idle_timer;
+
+static bool g_recording;
+static bool g_replaying;
+static sdl_timer_t g_replay_timer;
 
 bool director_initialize()
 {
+	// SWARM_SEED reproduces an earlier run, the seed is logged either way
+	const char *seed_string= SDL_getenv("SWARM_SEED");
+	uint64_t seed= seed_string ? strtoull(seed_string, NULL, 0) : static_cast<uint64_t>(time(NULL));
+
+	// a replay brings its own seed and replaces the camera and gestures
+	g_replaying= !g_config.replay_filepath.empty();
+	if (g_replaying && !replayer_open(g_config.replay_filepath.c_str(), seed))
+	{
+		return false;
+	}
+
+	g_recording= !g_replaying && !g_config.record_filepath.empty();
+	if (g_recording && !recorder_open(g_config.record_filepath.c_str(), seed))
+	{
+		return false;
+	}
+
+	trace_thread("main");
+	random_seed(seed);
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Random seed %llu", static_cast<unsigned long long>(seed));
+
+	workers_initialize();
+	simulation_initialize(g_replaying);
 	graphics_initialize();
 	audio_initialize();
-	camera_initialize();
-	gesture_initialize();
+	g_frame_index= 0;
+	g_frame_fresh= false;
+	g_submitted_edge_mask= NULL;
+	g_submitted_frame_count= -1;
+	if (g_replaying)
+	{
+		g_frames[g_frame_index].camera.video_frame= cv::Mat::zeros(k_camera_height, k_camera_width, CV_8UC3);
+		g_replay_timer.reset();
+	}
+	else
+	{
+		director_frame_t &frame= g_frames[g_frame_index];
+
+		camera_initialize();
+		gesture_initialize();
+
+		// the first frame shows the camera as it is now, from then on the camera runs one frame ahead
+		camera_consume_full_frame(frame.camera, frame.edge_frame, frame.edge_mask, frame.edge_counts, g_debug || g_recording);
+
+		// each frame's camera task overlaps the stages showing the frame before it
+		g_frame_graph.initialize(k_frame_graph_thread_count);
+		g_frame_graph.add("camera", false, director_camera_task);
+		int gesture= g_frame_graph.add("gesture", true, director_gesture_task);
+		int swarm= g_frame_graph.add("swarm", true, director_swarm_task, {gesture});
+		g_frame_graph.add("render", true, director_render_task, {swarm});
+		g_frame_graph.add("audio", false, director_audio_task, {swarm});
+		g_frame_graph_report_timer.reset();
+	}
 
 	g_running= true;
 	g_fullscreen= false;
@@ -61,12 +153,14 @@ bool director_initialize()
 	g_debug= false;
 	g_fps= false;
 	
-	g_last_edge_frame= cv::Mat::zeros(k_edge_height, k_edge_width, CV_8U);
+	g_last_edge_counts= cv::Mat::zeros(g_config.field_height, g_config.field_width, CV_32S);
 
 	g_idle_image_index= k_title_image_index;
 	for (int idle_image_index= 0; idle_image_index<k_idle_image_count; idle_image_index++)
 	{
 		g_idle_images[idle_image_index]= cv::imread(k_idle_image_filepaths[idle_image_index], cv::IMREAD_GRAYSCALE);
+		g_idle_edge_masks[idle_image_index].pack(g_idle_images[idle_image_index]);
+		camera_count_edges(g_idle_edge_masks[idle_image_index], g_idle_edge_counts[idle_image_index]);
 	}
 	g_idle_timer.start(k_title_time);
 
@@ -75,10 +169,17 @@ bool director_initialize()
 
 void director_dispose()
 {
+	g_frame_graph.dispose();
+	camera_release_frame(g_frames[0].camera);
+	camera_release_frame(g_frames[1].camera);
+	replayer_close();
+	recorder_close();
 	gesture_dispose();
 	camera_dispose();
 	audio_dispose();
 	graphics_dispose();
+	simulation_dispose();
+	workers_dispose();
 }
 
 bool director_is_running()
@@ -88,17 +189,117 @@ bool director_is_running()
 
 void director_do_frame()
 {
-	camera_consume_full_frame(g_video_frame, g_depth_frame, g_edge_frame);
-	director_idle_update(g_commands.size());
-	if (g_idle)
+	if (g_replaying)
 	{
-		g_idle_images[g_idle_image_index].copyTo(g_edge_frame);
+		director_replay_frame();
+		return;
+	}
 
+	g_frame_graph.run();
+	if (g_frame_fresh)
+	{
+		g_frame_index^= 1;
 	}
+
+	if (g_frame_graph_report_timer.passed(k_frame_graph_report_period))
+	{
+		g_frame_graph.log_timings();
+		g_frame_graph.reset_timings();
+		camera_log_statistics();
+		if (g_gesture_detection)
+		{
+			gesture_log_statistics();
+		}
+		g_frame_graph_report_timer.reset();
+	}
+}
+
+// fills the slot the next frame shows, off the main thread. the kinect runs at 30 Hz and the frame
+// graph at 60, so every other tick the camera has nothing new and the shown slot is kept instead
+static void director_camera_task()
+{
+	director_frame_t &frame= g_frames[g_frame_index^1];
+
+	g_frame_fresh= camera_latest_frame_count()!=g_frames[g_frame_index].camera.frame_count;
+	if (g_frame_fresh)
+	{
+		camera_consume_full_frame(frame.camera, frame.edge_frame, frame.edge_mask, frame.edge_counts, g_debug || g_recording);
+	}
+}
+
+static void director_gesture_task()
+{
+	director_idle_update(g_commands.size());
 	gesture_consume_commands(g_commands);
-	g_swarm.update(g_edge_frame, g_commands);
-	graphics_render(g_swarm, g_debug, g_video_frame, g_depth_frame, g_edge_frame, g_commands, g_fps);
-	audio_render(g_swarm);
+}
+
+// idle frames are read in place, only the camera slots are written every frame
+static void director_swarm_task()
+{
+	director_frame_t &frame= g_frames[g_frame_index];
+	const cv::Mat1b &edge_frame= g_idle ? g_idle_images[g_idle_image_index] : director_edge_frame(frame);
+	const edge_mask_t &edge_mask= g_idle ? g_idle_edge_masks[g_idle_image_index] : frame.edge_mask;
+	const cv::Mat1i &edge_counts= g_idle ? g_idle_edge_counts[g_idle_image_index] : frame.edge_counts;
+
+	if (g_recording && !recorder_write(edge_frame, frame.camera.depth_frame, g_commands))
+	{
+		g_recording= false;
+	}
+	bool edges_changed= &edge_mask!=g_submitted_edge_mask || (!g_idle && frame.camera.frame_count!=g_submitted_frame_count);
+
+	simulation_submit(edge_mask, edge_counts, g_commands, edges_changed);
+	simulation_interpolate(g_swarm_frame);
+	g_submitted_edge_mask= &edge_mask;
+	g_submitted_frame_count= frame.camera.frame_count;
+}
+
+static void director_render_task()
+{
+	director_frame_t &frame= g_frames[g_frame_index];
+	const cv::Mat1b &edge_frame= g_idle ? g_idle_images[g_idle_image_index] : director_edge_frame(frame);
+
+	graphics_render(g_swarm_frame, g_debug, frame.camera.video_frame, frame.camera.depth_frame, edge_frame, g_commands, g_fps);
+}
+
+static void director_audio_task()
+{
+	audio_render(g_swarm_frame);
+}
+
+// the camera task only unpacks the edge frame while something shows or records it, this catches
+// the frame on screen when either starts
+static const cv::Mat1b &director_edge_frame(director_frame_t &frame)
+{
+	if ((g_debug || g_recording) && frame.edge_frame.empty())
+	{
+		frame.edge_mask.unpack(frame.edge_frame);
+	}
+	return frame.edge_frame;
+}
+
+// recorded frames go straight to the swarm, the simulation steps in lockstep so every replay matches
+static void director_replay_frame()
+{
+	static int frame_count= 0;
+	director_frame_t &frame= g_frames[g_frame_index];
+
+	if (!replayer_read(frame.edge_frame, frame.camera.depth_frame, g_commands))
+	{
+		double time= g_replay_timer.elapsed();
+
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Replay finished, %d frames in %.2f s, %.1f fps", frame_count, time, frame_count/time);
+		g_running= false;
+		return;
+	}
+	frame_count++;
+
+	frame.edge_mask.pack(frame.edge_frame);
+	camera_count_edges(frame.edge_mask, frame.edge_counts);
+	simulation_submit(frame.edge_mask, frame.edge_counts, g_commands);
+	simulation_advance(k_simulation_rate/k_fps);
+	simulation_interpolate(g_swarm_frame);
+	graphics_render(g_swarm_frame, g_debug, frame.camera.video_frame, frame.camera.depth_frame, frame.edge_frame, g_commands, g_fps);
+	audio_render(g_swarm_frame);
 }
 
 void director_process_events()
@@ -107,7 +308,7 @@ void director_process_events()
 
 	while (SDL_PollEvent(&event))
 	{
-		SDL_LogInfo(SDL_LOG_CATEGORY_INPUT, "Received event type 0x%x", event.type);
+		trace_instant("event", event.type);
 
 		switch (event.type)
 		{
@@ -141,9 +342,24 @@ void director_process_events()
 						break;
 					}
 
+					case SDLK_EQUALS:
+					case SDLK_MINUS:
+					{
+						bool grow= code==SDLK_EQUALS;
+
+						simulation_post([grow](swarm_t &swarm)
+						{
+							int bee_count= grow ? swarm.bees.count+swarm.bees.count/4 : swarm.bees.count-swarm.bees.count/5;
+
+							swarm.resize(bee_count>0 ? bee_count : 1);
+							SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "%d bees", swarm.bees.count);
+						});
+						break;
+					}
+
 					case SDLK_a:
 					{
-						g_swarm.flow_active= !g_swarm.flow_active;
+						simulation_post([](swarm_t &swarm){ swarm.flow_active= !swarm.flow_active; });
 						break;
 					}
 
@@ -185,12 +401,30 @@ void director_process_events()
 						break;
 					}
 
+					case SDLK_p:
+					{
+						simulation_post([](swarm_t &swarm){ swarm.parallel_active= !swarm.parallel_active; });
+						break;
+					}
+
+					case SDLK_r:
+					{
+						trace_dump(g_config.trace_filepath.c_str());
+						break;
+					}
+
+					case SDLK_s:
+					{
+						simulation_post([](swarm_t &swarm){ swarm.separation_active= !swarm.separation_active; });
+						break;
+					}
+
 					case SDLK_t:
 					{
 						g_idle= true;
 						g_idle_image_index= k_title_image_index;
 						g_idle_timer.start(k_title_time);
-						g_swarm.reset();
+						simulation_post([](swarm_t &swarm){ swarm.reset(); });
 						break;
 					}
 
@@ -210,7 +444,9 @@ static void director_idle_update(int num_gestures)
 	}
 	else
 	{
-		double distance= cv::norm(g_last_edge_frame, g_edge_frame, cv::NORM_L1);
+		// compare per-cell edge counts rather than whole frames
+		const cv::Mat1i &edge_counts= g_frames[g_frame_index].edge_counts;
+		double distance= cv::norm(g_last_edge_counts, edge_counts, cv::NORM_L1);
 		if (!g_idle_timer.running())
 		{
 			if (distance>k_idle_maximum_image_distance)
@@ -225,11 +461,11 @@ static void director_idle_update(int num_gestures)
 				int last_idle_image_index= g_idle_image_index;
 				while (g_idle_image_index==last_idle_image_index)
 				{
-					g_idle_image_index= rand()%k_idle_image_count;
+					g_idle_image_index= random_stream(k_random_main_stream).uniform(k_idle_image_count);
 				}
 				g_idle_timer.reset();
 			}
 		}
-		g_edge_frame.copyTo(g_last_edge_frame);
+		edge_counts.copyTo(g_last_edge_counts);
 	}
 }
@@ -0,0 +1,72 @@
+#ifndef exchange_hpp
+#define exchange_hpp
+
+#include <atomic>
+#include <cassert>
+
+// hands the latest of a stream of slots from one writer to any number of readers without locks.
+// the writer fills a slot nobody is reading and publishes it, readers pin the latest published slot
+// and read it in place until they unpin it. slot_count has to cover every reader pinning a different
+// slot at once, plus the latest and the one being written
+template <int slot_count> class exchange_t
+{
+public:
+	exchange_t(int latest_slot= 0): latest(latest_slot)
+	{
+		for (int slot= 0; slot<slot_count; slot++)
+		{
+			pins[slot].store(0);
+		}
+	}
+
+	// writer only, a slot that is neither published nor pinned nor busy_slot, -1 if the readers hold them all
+	int acquire(int busy_slot= -1) const
+	{
+		int latest_slot= latest.load();
+
+		for (int slot= 0; slot<slot_count; slot++)
+		{
+			if (slot!=latest_slot && slot!=busy_slot && pins[slot].load()==0) return slot;
+		}
+		return -1;
+	}
+
+	// writer only, slot is the latest from now on
+	void publish(int slot)
+	{
+		assert(slot>=0 && slot<slot_count);
+		latest.store(slot);
+	}
+
+	// writer only, whether a reader may be looking at slot
+	bool held(int slot) const
+	{
+		return slot==latest.load() || pins[slot].load()>0;
+	}
+
+	// the latest slot, pinned so the writer leaves it alone. recheck after pinning in case the writer
+	// published and picked the slot again in between
+	int pin()
+	{
+		while (true)
+		{
+			int slot= latest.load();
+
+			pins[slot].fetch_add(1);
+			if (latest.load()==slot) return slot;
+			pins[slot].fetch_sub(1);
+		}
+	}
+
+	void unpin(int slot)
+	{
+		assert(slot>=0 && slot<slot_count && pins[slot].load()>0);
+		pins[slot].fetch_sub(1);
+	}
+
+private:
+	std::atomic<int> latest;
+	std::atomic<int> pins[slot_count];
+};
+
+#endif /* exchange_hpp */
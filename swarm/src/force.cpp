@@ -0,0 +1,97 @@
+#include <cassert>
+#include <cmath>
+
+#include <opencv2/imgproc.hpp>
+
+#include "force.hpp"
+
+const int k_force_rebuild_period= 120; // updates, bounds the drift of incremental updates
+
+force_field_t::force_field_t(): radius(0), frames_since_rebuild(0)
+{
+}
+
+void force_field_t::initialize(int rows, int cols, int radius)
+{
+	int diameter= 2*radius+1;
+	cv::Mat1f attract_y= cv::Mat::zeros(diameter, diameter, CV_32F);
+	cv::Mat1f attract_x= cv::Mat::zeros(diameter, diameter, CV_32F);
+
+	this->radius= radius;
+
+	// unit vectors toward the kernel center, the last row and column stay zero because
+	// the original per-seed stamping stopped one short of the radius on the positive side
+	for (int y= 0; y<diameter-1; y++)
+	{
+		for (int x= 0; x<diameter-1; x++)
+		{
+			float norm= std::sqrt(static_cast<float>((radius-y)*(radius-y) + (radius-x)*(radius-x)));
+
+			if (norm!=0.0f)
+			{
+				attract_y(y, x)= (radius-y)/norm;
+				attract_x(y, x)= (radius-x)/norm;
+			}
+		}
+	}
+
+	// filter2D correlates, flipping the kernel makes it the convolution the stamping computed
+	cv::flip(attract_y, kernel_y, -1);
+	cv::flip(attract_x, kernel_x, -1);
+
+	field= cv::Mat::zeros(rows, cols, CV_32FC2);
+	last_seeds= cv::Mat::zeros(rows, cols, CV_8U);
+	frames_since_rebuild= 0;
+}
+
+void force_field_t::update(const cv::Mat1b &seeds)
+{
+	assert(seeds.size()==field.size());
+
+	cv::compare(seeds, last_seeds, changed, cv::CMP_NE);
+
+	cv::Rect dirty= cv::boundingRect(changed);
+
+	if (dirty.area()==0)
+	{
+		return;
+	}
+
+	if (++frames_since_rebuild>=k_force_rebuild_period || 2*dirty.area()>static_cast<int>(seeds.total()))
+	{
+		rebuild(seeds);
+	}
+	else
+	{
+		// seeds outside the dirty rectangle are unchanged, so the field only moves within radius of it
+		cv::Rect region(dirty.x-radius, dirty.y-radius, dirty.width+2*radius, dirty.height+2*radius);
+		cv::Mat1f delta;
+		cv::Mat2f delta_field;
+
+		region&= cv::Rect(0, 0, seeds.cols, seeds.rows);
+		cv::subtract(seeds(region), last_seeds(region), delta, cv::noArray(), CV_32F);
+		filter(delta, delta_field);
+		field(region)+= delta_field;
+	}
+
+	seeds.copyTo(last_seeds);
+}
+
+void force_field_t::rebuild(const cv::Mat1b &seeds)
+{
+	cv::Mat1f mask;
+
+	seeds.convertTo(mask, CV_32F);
+	filter(mask, field);
+	frames_since_rebuild= 0;
+}
+
+void force_field_t::filter(const cv::Mat1f &seeds, cv::Mat2f &result)
+{
+	// large kernels make filter2D switch to its DFT path
+	cv::Mat1f channels[2];
+
+	cv::filter2D(seeds, channels[0], CV_32F, kernel_y, cv::Point(-1, -1), 0.0, cv::BORDER_CONSTANT);
+	cv::filter2D(seeds, channels[1], CV_32F, kernel_x, cv::Point(-1, -1), 0.0, cv::BORDER_CONSTANT);
+	cv::merge(channels, 2, result);
+}
@@ -0,0 +1,29 @@
+#ifndef force_hpp
+#define force_hpp
+
+#include <opencv2/core.hpp>
+
+// attraction field of the drawing mode, the sum of edge_attract kernels centered on every seed pixel.
+// built as a convolution, and after the first frame only the dirty rectangle of changed seeds is refiltered
+class force_field_t
+{
+public:
+	force_field_t();
+
+	void initialize(int rows, int cols, int radius);
+	void update(const cv::Mat1b &seeds);
+
+	cv::Mat2f field; // (y, x) pull toward nearby seeds
+
+private:
+	void rebuild(const cv::Mat1b &seeds);
+	void filter(const cv::Mat1f &seeds, cv::Mat2f &result);
+
+	int radius;
+	int frames_since_rebuild;
+	cv::Mat1f kernel_y, kernel_x; // edge_attract channels, flipped for filter2D
+	cv::Mat1b last_seeds;
+	cv::Mat1b changed;
+};
+
+#endif /* force_hpp */
@@ -1,13 +1,37 @@
+#include <algorithm>
+#include <cstring>
 #include <mutex>
 #include <thread>
 
+#include <SDL_log.h>
+
 #include "camera.hpp"
+#include "config.hpp"
 #include "constants.hpp"
 #include "gesture.hpp"
 #include "model.hpp"
+#include "timer.hpp"
+#include "trace.hpp"
+#include "tracker.hpp"
+
+const char *k_gesture_names[k_gesture_count]=
+{
+	"longhorn",
+	"peace",
+	"palm",
+	"fist",
+	"thumbsup",
+	"left",
+	"right",
+	"fingerscrossed"
+};
+
+static const double k_gesture_wait_timeout= 0.1; // seconds, how often a waiting thread checks whether to stop
 
 static void gesture_thread_function();
 
+bool g_gesture_detection= true;
+
 static bool g_gesture_thread_run= false;
 static std::thread *g_gesture_thread= NULL;
 
@@ -15,8 +39,31 @@ static std::mutex g_commands_mutex;
 static commands_t g_commands;
 static bool g_commands_available= false;
 
+// read and reset by gesture_log_statistics
+static std::mutex g_gesture_statistics_mutex;
+static sdl_timer_t g_gesture_statistics_timer;
+static int g_inference_count= 0;
+static int g_track_count= 0;
+static int g_command_count= 0;
+static double g_frame_age_total= 0.0;
+static double g_frame_age_maximum= 0.0;
+
+gesture_t gesture_from_name(const char *name)
+{
+	for (int gesture= 0; gesture<k_gesture_count; gesture++)
+	{
+		if (std::strcmp(name, k_gesture_names[gesture])==0)
+		{
+			return static_cast<gesture_t>(gesture);
+		}
+	}
+
+	return k_gesture_count;
+}
+
 bool gesture_initialize()
 {
+	g_gesture_statistics_timer.reset();
 	g_gesture_thread_run= true;
 	g_gesture_thread= new std::thread(gesture_thread_function);
 
@@ -54,18 +101,82 @@ bool gesture_consume_commands(commands_t &commands)
 
 static void gesture_thread_function()
 {
-	cv::Mat3b video_frame;
+	camera_frame_t frame;
 	commands_t commands;
 	model_t model;
+	tracker_t tracker;
+	int tracked_count= 0; // frames tracked since the last detection
+
+	trace_thread("gesture");
 
 	while (g_gesture_thread_run)
 	{
-		camera_peek_video_frame(video_frame);
-		model.analyze_frame(video_frame(cv::Rect(k_edge_x, k_edge_y, k_edge_width, k_edge_height)), commands);
+		// only new camera frames are worth a look, sleep until there is one
+		if (!camera_wait_frame(frame.frame_count, k_gesture_wait_timeout)) continue;
+
+		sdl_timer_t timer;
+		bool tracked= false;
+
+		camera_peek_video_frame(frame);
+		cv::Mat3b edge_video_frame= frame.video_frame(cv::Rect(k_edge_x, k_edge_y, k_edge_width, k_edge_height));
+
+		// the detector runs every gesture_detect_interval frames, in between the tracker moves its boxes
+		if (tracked_count+1<g_config.gesture_detect_interval)
+		{
+			trace_begin("track");
+			tracked= tracker.update(edge_video_frame, commands);
+			trace_end("track");
+		}
+
+		if (tracked)
+		{
+			tracked_count++;
+		}
+		else
+		{
+			trace_begin("analyze");
+			model.analyze_frame(edge_video_frame, commands);
+			tracker.start(edge_video_frame, commands);
+			trace_end("analyze");
+			tracked_count= 0;
+		}
+		trace_instant("gesture result", commands.empty() ? -1 : commands[0].gesture);
+
+		float frame_age= static_cast<float>(frame.latency+timer.elapsed());
+		for (int command_index= 0; command_index<commands.size(); command_index++)
+		{
+			commands[command_index].frame_age= frame_age;
+		}
+
+		g_gesture_statistics_mutex.lock();
+		g_inference_count+= tracked ? 0 : 1;
+		g_track_count+= tracked ? 1 : 0;
+		g_command_count+= static_cast<int>(commands.size());
+		g_frame_age_total+= frame_age*commands.size();
+		g_frame_age_maximum= commands.empty() ? g_frame_age_maximum : std::max<double>(g_frame_age_maximum, frame_age);
+		g_gesture_statistics_mutex.unlock();
 
 		g_commands_mutex.lock();
 		g_commands= commands;
 		g_commands_available= true;
 		g_commands_mutex.unlock();
 	}
+
+	camera_release_frame(frame);
+}
+
+void gesture_log_statistics()
+{
+	std::lock_guard<std::mutex> lock(g_gesture_statistics_mutex);
+	double time= g_gesture_statistics_timer.elapsed();
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Gesture inference %.1f Hz, tracking %.1f Hz, %d commands, frame age %.1f ms average, %.1f ms worst",
+		g_inference_count/time, g_track_count/time, g_command_count, g_command_count>0 ? 1000.0*g_frame_age_total/g_command_count : 0.0, 1000.0*g_frame_age_maximum);
+
+	g_gesture_statistics_timer.reset();
+	g_inference_count= 0;
+	g_track_count= 0;
+	g_command_count= 0;
+	g_frame_age_total= 0.0;
+	g_frame_age_maximum= 0.0;
 }
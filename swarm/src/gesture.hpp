@@ -1,22 +1,45 @@
 #ifndef gesture_hpp
 #define gesture_hpp
 
-#include <string>
 #include <vector>
 
+// classes the model knows, interned from res/gesture.names when it loads
+enum gesture_t
+{
+	_gesture_longhorn,
+	_gesture_peace,
+	_gesture_palm,
+	_gesture_fist,
+	_gesture_thumbsup,
+	_gesture_left,
+	_gesture_right,
+	_gesture_fingerscrossed,
+	k_gesture_count
+};
+
+extern const char *k_gesture_names[k_gesture_count];
+
+// k_gesture_count for names we have no gesture for
+gesture_t gesture_from_name(const char *name);
+
 struct command_t
 {
-	std::string name;
+	gesture_t gesture;
 	cv::Rect bounding_box;
 	float confidence;
-	// $TODO add information
+	float frame_age; // seconds from the camera frame arriving to the command being made, 0 when not from the camera
 };
 
 typedef std::vector<command_t> commands_t;
 
+extern bool g_gesture_detection;
+
 bool gesture_initialize();
 void gesture_dispose();
 
 bool gesture_consume_commands(commands_t &commands);
 
+// inference and tracking rates and command frame age since the last call
+void gesture_log_statistics();
+
 #endif /* gesture_hpp */
@@ -1,64 +1,43 @@
 #include <cassert>
 #include <cstdio>
+#include <vector>
 
 #include <libfreenect.h>
 #include <SDL.h>
 #include <SDL_ttf.h>
 
+#include "config.hpp"
 #include "constants.hpp"
 #include "graphics.hpp"
 
-const int k_window_width= k_simulation_width;
-const int k_window_height= k_simulation_height;
-
-const int k_view_width= k_window_width/2;
-const int k_view_height= k_window_height/2;
-
-// assume 4:3 camera aspect ratio...
-const int k_scaled_camera_width= k_view_height*4/3;
-const int k_scaled_camera_height= k_view_height;
-const int k_scaled_camera_x= (k_view_width-k_scaled_camera_width)/2;
-const int k_scaled_camera_y= 0;
-
-// ...and use the center 16:9 portion of it
-const int k_scaled_clip_width= k_scaled_camera_width;
-const int k_scaled_clip_height= k_scaled_camera_width*9/16;
-const int k_scaled_clip_x= (k_scaled_camera_width-k_scaled_clip_width)/2;
-const int k_scaled_clip_y= (k_scaled_camera_height-k_scaled_clip_height)/2;
-
-// video frame is top left quarter of the debug view
-const SDL_Rect k_video_rect= {k_scaled_camera_x, k_scaled_camera_y, k_scaled_camera_width, k_scaled_camera_height};
-const SDL_Rect k_video_clip_rect= {k_video_rect.x+k_scaled_clip_x, k_video_rect.y+k_scaled_clip_y, k_scaled_clip_width, k_scaled_clip_height};
-
-// depth frame is top right quarter of the debug view
-const SDL_Rect k_depth_rect= {k_view_width+k_scaled_camera_x, k_scaled_camera_y, k_scaled_camera_width, k_scaled_camera_height};
-const SDL_Rect k_depth_clip_rect= {k_depth_rect.x+k_scaled_clip_x, k_depth_rect.y+k_scaled_clip_y, k_scaled_clip_width, k_scaled_clip_height};
-
-// edge frame is the lower left quarter of the debug view
-const SDL_Rect k_edge_rect= {0, k_view_height, k_view_width, k_view_height};
-
-// swarm is the lower right quarter of the debug view
-const SDL_Rect k_swarm_rect= {k_view_width, k_view_height, k_view_width, k_view_height};
-
-const char *k_bee_texture_filepaths[bee_t::k_state_count]=
+const char *k_bee_texture_filepaths[bees_t::k_state_count]=
 {
 	"res/32_Idle_Sheet.bmp",
 	"res/32_Crawl_Sheet.bmp",
 	"res/32_Fly_Sheet.bmp"
 };
 
+static void graphics_layout();
 static SDL_Texture *graphics_create_texture_from_image_file(const char *filePath, int &width, int &height);
 static SDL_Texture *graphics_create_texture_from_video_frame(const cv::Mat3b &video_frame);
 static SDL_Texture *graphics_create_texture_from_depth_frame(const cv::Mat1w &depth_frame);
 static SDL_Texture *graphics_create_texture_from_edge_frame(const cv::Mat1b &edge_frame);
 static SDL_Texture *graphics_create_texture_from_string(const char *string, const SDL_Color &color, int &width, int &height);
 
+// window matches the simulation, the debug view splits it into quarters
+static int g_window_width= 0;
+static int g_window_height= 0;
+static SDL_Rect g_video_rect, g_video_clip_rect;
+static SDL_Rect g_depth_rect, g_depth_clip_rect;
+static SDL_Rect g_edge_rect;
+static SDL_Rect g_swarm_rect;
+
 SDL_Window *g_window= NULL;
 SDL_Renderer *g_renderer= NULL;
 TTF_Font *g_font= NULL;
-SDL_Texture *g_bee_textures[bee_t::k_state_count]= {NULL, NULL, NULL};
-int g_bee_sprite_counts[bee_t::k_state_count]= {0, 0, 0};
-int g_bee_sprite_sizes[bee_t::k_state_count]= {0, 0, 0};
+SDL_Texture *g_bee_textures[bees_t::k_state_count]= {NULL, NULL, NULL};
+int g_bee_sprite_counts[bees_t::k_state_count]= {0, 0, 0};
+int g_bee_sprite_sizes[bees_t::k_state_count]= {0, 0, 0};
 
 static int g_frame_count= 0;
 static uint64_t g_last_frame_time= 0;
@@ -68,7 +47,8 @@ bool graphics_initialize()
 {
 	bool success= false;
 
-	if (SDL_CreateWindowAndRenderer(k_window_width, k_window_height, 0, &g_window, &g_renderer)==0)
+	graphics_layout();
+	if (SDL_CreateWindowAndRenderer(g_window_width, g_window_height, 0, &g_window, &g_renderer)==0)
 	{
 		if (TTF_Init()==0)
 		{
@@ -76,7 +56,7 @@ bool graphics_initialize()
 
 			if (g_font)
 			{
-				for (int state= 0; state<bee_t::k_state_count; state++)
+				for (int state= 0; state<bees_t::k_state_count; state++)
 				{
 					int texture_width, texture_height;
 
@@ -90,7 +70,7 @@ bool graphics_initialize()
 					}
 				}
 
-				if (g_bee_textures[bee_t::_idle] && g_bee_textures[bee_t::_crawling] && g_bee_textures[bee_t::_flying])
+				if (g_bee_textures[bees_t::_idle] && g_bee_textures[bees_t::_crawling] && g_bee_textures[bees_t::_flying])
 				{
 					g_frame_count= 0;
 					g_last_frame_time= SDL_GetPerformanceCounter();
@@ -121,7 +101,7 @@ bool graphics_initialize()
 
 void graphics_dispose()
 {
-	for (int state= bee_t::k_state_count-1; state>=0; state--)
+	for (int state= bees_t::k_state_count-1; state>=0; state--)
 	{
 		if (g_bee_textures[state])
 		{
@@ -175,7 +155,7 @@ bool graphics_change_mode(bool fullscreen)
 	return success;
 }
 
-int graphics_render(const swarm_t &swarm, bool debug, const cv::Mat3b &video_frame, const cv::Mat1w &depth_frame, const cv::Mat1b &edge_frame, const commands_t &commands, bool fps)
+int graphics_render(const swarm_frame_t &swarm, bool debug, const cv::Mat3b &video_frame, const cv::Mat1w &depth_frame, const cv::Mat1b &edge_frame, const commands_t &commands, bool fps)
 {
 	if (g_renderer)
 	{
@@ -192,45 +172,48 @@ int graphics_render(const swarm_t &swarm, bool debug, const cv::Mat3b &video_fra
 
 		// render bees
 		{
-			float ox= static_cast<float>(debug ? k_swarm_rect.x : 0);
-			float oy= static_cast<float>(debug ? k_swarm_rect.y : 0);
-			float dx= static_cast<float>(debug ? k_swarm_rect.w : k_window_width)/k_simulation_width;
-			float dy= static_cast<float>(debug ? k_swarm_rect.h : k_window_height)/k_simulation_height;
+			float ox= static_cast<float>(debug ? g_swarm_rect.x : 0);
+			float oy= static_cast<float>(debug ? g_swarm_rect.y : 0);
+			float dx= static_cast<float>(debug ? g_swarm_rect.w : g_window_width)/g_config.simulation_width;
+			float dy= static_cast<float>(debug ? g_swarm_rect.h : g_window_height)/g_config.simulation_height;
 
 			if (debug)
 			{
-				const SDL_Color colors[bee_t::k_state_count]=
+				const SDL_Color colors[bees_t::k_state_count]=
 				{
 					{0xff, 0x7f, 0x00, 0xff},
 					{0xff, 0xbf, 0x00, 0xff},
 					{0xff, 0xff, 0x00, 0xff}
 				};
 
-				for (int state= 0; state<bee_t::k_state_count; state++)
+				const bees_t &bees= swarm.bees;
+
+				static std::vector<SDL_FPoint> points;
+
+				points.resize(bees.count);
+				for (int state= 0; state<bees_t::k_state_count; state++)
 				{
-					SDL_FPoint points[k_bee_count];
 					int point_count= 0;
 
-					for (int bee_index= 0; bee_index<k_bee_count; bee_index++)
+					for (int bee_index= 0; bee_index<bees.count; bee_index++)
 					{
-						const bee_t *bee= &swarm.bees[bee_index];
-
-						if (bee->state==state)
+						if (bees.state[bee_index]==state)
 						{
 							SDL_FPoint *point= &points[point_count++];
 
-							point->x= ox + bee->x*dx;
-							point->y= oy + bee->y*dy;
+							point->x= ox + bees.x[bee_index]*dx;
+							point->y= oy + bees.y[bee_index]*dy;
 						}
 					}
 
 					SDL_SetRenderDrawColor(g_renderer, colors[state].r, colors[state].g, colors[state].b, colors[state].a);
-					SDL_RenderDrawPointsF(g_renderer, points, point_count);
+					SDL_RenderDrawPointsF(g_renderer, points.data(), point_count);
 				}
 			}
 			else
 			{
-				int64_t sprite_base_index= static_cast<int64_t>(swarm.t/k_dt);
+				const bees_t &bees= swarm.bees;
+				int64_t sprite_base_index= static_cast<int64_t>(swarm.t*k_fps); // sprites animate at the render rate
 				SDL_Rect src_rect;
 				SDL_FRect dst_rect;
 
@@ -239,7 +222,7 @@ int graphics_render(const swarm_t &swarm, bool debug, const cv::Mat3b &video_fra
 				dst_rect.w= 2*k_bee_radius*dx;
 				dst_rect.h= 2*k_bee_radius*dy;
 
-				for (int state= 0; state<bee_t::k_state_count; state++)
+				for (int state= 0; state<bees_t::k_state_count; state++)
 				{
 					SDL_Texture *texture= g_bee_textures[state];
 					int sprite_count= g_bee_sprite_counts[state];
@@ -248,18 +231,16 @@ int graphics_render(const swarm_t &swarm, bool debug, const cv::Mat3b &video_fra
 					src_rect.w= sprite_size;
 					src_rect.h= sprite_size;
 
-					for (int bee_index= 0; bee_index<k_bee_count; bee_index++)
+					for (int bee_index= 0; bee_index<bees.count; bee_index++)
 					{
-						const bee_t *bee= &swarm.bees[bee_index];
-
-						if (bee->state==state)
+						if (bees.state[bee_index]==state)
 						{
-							src_rect.x= ((sprite_base_index+bee_index)%sprite_count)*sprite_size;
+							src_rect.x= ((sprite_base_index+bees.id[bee_index])%sprite_count)*sprite_size;
 
-							dst_rect.x= ox + (bee->x-k_bee_radius)*dx;
-							dst_rect.y= oy + (bee->y-k_bee_radius)*dy;
+							dst_rect.x= ox + (bees.x[bee_index]-k_bee_radius)*dx;
+							dst_rect.y= oy + (bees.y[bee_index]-k_bee_radius)*dy;
 
-							SDL_RenderCopyExF(g_renderer, texture,  &src_rect,  &dst_rect, 57.2957795131*bee->facing+90.0, NULL, SDL_FLIP_NONE);
+							SDL_RenderCopyExF(g_renderer, texture,  &src_rect,  &dst_rect, 57.2957795131*bees.facing[bee_index]+90.0, NULL, SDL_FLIP_NONE);
 						}
 					}
 				}
@@ -269,10 +250,10 @@ int graphics_render(const swarm_t &swarm, bool debug, const cv::Mat3b &video_fra
 		// render landed
 		if (debug)
 		{
-			float ox= static_cast<float>(debug ? k_swarm_rect.x : 0);
-			float oy= static_cast<float>(debug ? k_swarm_rect.y : 0);
-			float dx= static_cast<float>(debug ? k_swarm_rect.w : k_window_width)/swarm.landed.cols;
-			float dy= static_cast<float>(debug ? k_swarm_rect.h : k_window_height)/swarm.landed.rows;
+			float ox= static_cast<float>(debug ? g_swarm_rect.x : 0);
+			float oy= static_cast<float>(debug ? g_swarm_rect.y : 0);
+			float dx= static_cast<float>(debug ? g_swarm_rect.w : g_window_width)/swarm.landed.cols;
+			float dy= static_cast<float>(debug ? g_swarm_rect.h : g_window_height)/swarm.landed.rows;
 
 			SDL_SetRenderDrawColor(g_renderer, 0xbf, 0x55, 0x00, 0x3f);
 
@@ -299,10 +280,10 @@ int graphics_render(const swarm_t &swarm, bool debug, const cv::Mat3b &video_fra
 		// render flow
 		if (debug && swarm.flow_active)
 		{
-			float ox= static_cast<float>(debug ? k_swarm_rect.x : 0);
-			float oy= static_cast<float>(debug ? k_swarm_rect.y : 0);
-			float dx= static_cast<float>(debug ? k_swarm_rect.w : k_window_width)/swarm.flow.cols;
-			float dy= static_cast<float>(debug ? k_swarm_rect.h : k_window_height)/swarm.flow.rows;
+			float ox= static_cast<float>(debug ? g_swarm_rect.x : 0);
+			float oy= static_cast<float>(debug ? g_swarm_rect.y : 0);
+			float dx= static_cast<float>(debug ? g_swarm_rect.w : g_window_width)/swarm.flow.cols;
+			float dy= static_cast<float>(debug ? g_swarm_rect.h : g_window_height)/swarm.flow.rows;
 
 			SDL_SetRenderDrawColor(g_renderer, 0x00, 0xff, 0x00, 0xff);
 
@@ -310,11 +291,11 @@ int graphics_render(const swarm_t &swarm, bool debug, const cv::Mat3b &video_fra
 			{
 				for (int x= 0; x<swarm.flow.cols; x++)
 				{
-					float flow= swarm.flow(y, x);
+					cv::Vec2f flow= swarm.flow(y, x);
 					float x0= ox + (x+0.5f)*dx;
 					float y0= oy + (y+0.5f)*dy;
-					float x1= x0 + 0.5f*dx*cos(flow);
-					float y1= y0 + 0.5f*dy*sin(flow);
+					float x1= x0 + 0.5f*dx*flow[0];
+					float y1= y0 + 0.5f*dy*flow[1];
 
 					SDL_RenderDrawLineF(g_renderer, x0, y0, x1, y1);
 				}
@@ -328,12 +309,12 @@ int graphics_render(const swarm_t &swarm, bool debug, const cv::Mat3b &video_fra
 
 			if (video_texture)
 			{
-				SDL_RenderCopy(g_renderer, video_texture, NULL, &k_video_rect);
+				SDL_RenderCopy(g_renderer, video_texture, NULL, &g_video_rect);
 				SDL_DestroyTexture(video_texture);
 			}
 
 			SDL_SetRenderDrawColor(g_renderer, 0x00, 0x00, 0xff, 0xff);
-			SDL_RenderDrawRect(g_renderer, &k_video_clip_rect);
+			SDL_RenderDrawRect(g_renderer, &g_video_clip_rect);
 		}
 
 		// render depth
@@ -343,12 +324,12 @@ int graphics_render(const swarm_t &swarm, bool debug, const cv::Mat3b &video_fra
 
 			if (depth_texture)
 			{
-				SDL_RenderCopy(g_renderer, depth_texture, NULL, &k_depth_rect);
+				SDL_RenderCopy(g_renderer, depth_texture, NULL, &g_depth_rect);
 				SDL_DestroyTexture(depth_texture);
 			}
 
 			SDL_SetRenderDrawColor(g_renderer, 0x00, 0x00, 0xff, 0xff);
-			SDL_RenderDrawRect(g_renderer, &k_depth_clip_rect);
+			SDL_RenderDrawRect(g_renderer, &g_depth_clip_rect);
 		}
 
 		// render edges
@@ -358,7 +339,7 @@ int graphics_render(const swarm_t &swarm, bool debug, const cv::Mat3b &video_fra
 
 			if (edge_texture)
 			{
-				SDL_RenderCopy(g_renderer, edge_texture, NULL, &k_edge_rect);
+				SDL_RenderCopy(g_renderer, edge_texture, NULL, &g_edge_rect);
 				SDL_DestroyTexture(edge_texture);
 			}
 		}
@@ -371,10 +352,10 @@ int graphics_render(const swarm_t &swarm, bool debug, const cv::Mat3b &video_fra
 				const command_t *command= &commands[command_index];
 				SDL_Rect command_rect;
 
-				command_rect.x= k_video_clip_rect.x + command->bounding_box.x*k_video_clip_rect.w/edge_frame.cols;
-				command_rect.y= k_video_clip_rect.y + command->bounding_box.y*k_video_clip_rect.h/edge_frame.rows;
-				command_rect.w= command->bounding_box.width*k_video_clip_rect.w/edge_frame.cols;
-				command_rect.h= command->bounding_box.height*k_video_clip_rect.h/edge_frame.rows;
+				command_rect.x= g_video_clip_rect.x + command->bounding_box.x*g_video_clip_rect.w/edge_frame.cols;
+				command_rect.y= g_video_clip_rect.y + command->bounding_box.y*g_video_clip_rect.h/edge_frame.rows;
+				command_rect.w= command->bounding_box.width*g_video_clip_rect.w/edge_frame.cols;
+				command_rect.h= command->bounding_box.height*g_video_clip_rect.h/edge_frame.rows;
 
 				SDL_SetRenderDrawColor(g_renderer, 0x00, 0x00, 0xff, 0xff);
 				SDL_RenderDrawRect(g_renderer, &command_rect);
@@ -392,7 +373,7 @@ int graphics_render(const swarm_t &swarm, bool debug, const cv::Mat3b &video_fra
 
 			if (fps_texture)
 			{
-				SDL_Rect text_rect= {k_window_width-width-8, 8, width, height};
+				SDL_Rect text_rect= {g_window_width-width-8, 8, width, height};
 				SDL_RenderCopy(g_renderer, fps_texture, NULL, &text_rect);
 				SDL_DestroyTexture(fps_texture);
 			}
@@ -413,6 +394,41 @@ int graphics_render(const swarm_t &swarm, bool debug, const cv::Mat3b &video_fra
 	return g_frame_count++;
 }
 
+static void graphics_layout()
+{
+	g_window_width= g_config.simulation_width;
+	g_window_height= g_config.simulation_height;
+
+	int view_width= g_window_width/2;
+	int view_height= g_window_height/2;
+
+	// assume 4:3 camera aspect ratio...
+	int scaled_camera_width= view_height*4/3;
+	int scaled_camera_height= view_height;
+	int scaled_camera_x= (view_width-scaled_camera_width)/2;
+	int scaled_camera_y= 0;
+
+	// ...and use the center 16:9 portion of it
+	int scaled_clip_width= scaled_camera_width;
+	int scaled_clip_height= scaled_camera_width*9/16;
+	int scaled_clip_x= (scaled_camera_width-scaled_clip_width)/2;
+	int scaled_clip_y= (scaled_camera_height-scaled_clip_height)/2;
+
+	// video frame is top left quarter of the debug view
+	g_video_rect= {scaled_camera_x, scaled_camera_y, scaled_camera_width, scaled_camera_height};
+	g_video_clip_rect= {g_video_rect.x+scaled_clip_x, g_video_rect.y+scaled_clip_y, scaled_clip_width, scaled_clip_height};
+
+	// depth frame is top right quarter of the debug view
+	g_depth_rect= {view_width+scaled_camera_x, scaled_camera_y, scaled_camera_width, scaled_camera_height};
+	g_depth_clip_rect= {g_depth_rect.x+scaled_clip_x, g_depth_rect.y+scaled_clip_y, scaled_clip_width, scaled_clip_height};
+
+	// edge frame is the lower left quarter of the debug view
+	g_edge_rect= {0, view_height, view_width, view_height};
+
+	// swarm is the lower right quarter of the debug view
+	g_swarm_rect= {view_width, view_height, view_width, view_height};
+}
+
 static SDL_Texture* graphics_create_texture_from_image_file(const char *filepath, int &width, int &height)
 {
 	SDL_Texture *texture= NULL;
@@ -0,0 +1,67 @@
+#include <cmath>
+
+#include "config.hpp"
+#include "constants.hpp"
+#include "grid.hpp"
+
+grid_t::grid_t(): cell_size(0.0f), rows(0), cols(0)
+{
+}
+
+void grid_t::initialize(float cell_size)
+{
+	// cover the gutter bees wrap through as well as the screen
+	this->cell_size= cell_size;
+	cols= static_cast<int>(std::ceil((g_config.simulation_width+2.0f*k_bee_radius)/cell_size));
+	rows= static_cast<int>(std::ceil((g_config.simulation_height+2.0f*k_bee_radius)/cell_size));
+	cell_starts.assign(rows*cols+1, 0);
+}
+
+void grid_t::cell(float x, float y, int &cell_x, int &cell_y) const
+{
+	cell_x= static_cast<int>((x+k_bee_radius)/cell_size);
+	cell_y= static_cast<int>((y+k_bee_radius)/cell_size);
+
+	if (cell_x<0) cell_x= 0;
+	else if (cell_x>=cols) cell_x= cols-1;
+	if (cell_y<0) cell_y= 0;
+	else if (cell_y>=rows) cell_y= rows-1;
+}
+
+void grid_t::build(const bees_t &bees)
+{
+	int cell_count= rows*cols;
+
+	bee_cells.resize(bees.count);
+	order.resize(bees.count);
+	x.resize(bees.count);
+	y.resize(bees.count);
+
+	// count bees per cell
+	cell_starts.assign(cell_count+1, 0);
+	for (int bee_index= 0; bee_index<bees.count; bee_index++)
+	{
+		int cell_x, cell_y;
+
+		cell(bees.x[bee_index], bees.y[bee_index], cell_x, cell_y);
+		bee_cells[bee_index]= cell_y*cols+cell_x;
+		cell_starts[bee_cells[bee_index]+1]++;
+	}
+
+	// prefix sum into start offsets
+	for (int cell_index= 0; cell_index<cell_count; cell_index++)
+	{
+		cell_starts[cell_index+1]+= cell_starts[cell_index];
+	}
+
+	// scatter, bees keep their relative order within a cell
+	cursors.assign(cell_starts.begin(), cell_starts.end()-1);
+	for (int bee_index= 0; bee_index<bees.count; bee_index++)
+	{
+		int slot= cursors[bee_cells[bee_index]]++;
+
+		order[slot]= bee_index;
+		x[slot]= bees.x[bee_index];
+		y[slot]= bees.y[bee_index];
+	}
+}
@@ -0,0 +1,31 @@
+#ifndef grid_hpp
+#define grid_hpp
+
+#include <vector>
+
+#include "bees.hpp"
+
+// uniform grid over bee positions, rebuilt every step with a counting sort.
+// bees of cell c are order[cell_starts[c], cell_starts[c+1]), with their positions copied alongside
+class grid_t
+{
+public:
+	grid_t();
+
+	void initialize(float cell_size);
+	void build(const bees_t &bees);
+
+	void cell(float x, float y, int &cell_x, int &cell_y) const;
+
+	float cell_size;
+	int rows, cols;
+	std::vector<int> cell_starts;
+	std::vector<int> order; // bee indices sorted by cell
+	std::vector<float> x, y; // positions in cell order, so queries never read the bees being written
+
+private:
+	std::vector<int> bee_cells;
+	std::vector<int> cursors;
+};
+
+#endif /* grid_hpp */
@@ -2,6 +2,8 @@
 
 #include <SDL.h>
 
+#include "benchmark.hpp"
+#include "config.hpp"
 #include "constants.hpp"
 #include "director.hpp"
 #include "timer.hpp"
@@ -14,17 +16,26 @@ int main(int argc, char *argv[])
 	SDL_LogSetAllPriority(SDL_LOG_PRIORITY_WARN);
 	#endif
 
-	if (SDL_Init(SDL_INIT_AUDIO|SDL_INIT_VIDEO|SDL_INIT_EVENTS)==0)
+	if (!config_initialize(argc, argv))
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't read config");
+		result= EXIT_FAILURE;
+	}
+	else if (g_config.benchmark)
+	{
+		result= benchmark_run() ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+	else if (SDL_Init(SDL_INIT_AUDIO|SDL_INIT_VIDEO|SDL_INIT_EVENTS)==0)
 	{
 		if (director_initialize())
 		{
-			timer_t timer;
+			sdl_timer_t timer;
 
 			while (director_is_running())
 			{
 				timer.reset();
 				director_do_frame();
-				do director_process_events(); while (!timer.passed(k_dt));
+				do director_process_events(); while (!timer.passed(g_config.replay_fast ? 0.0 : 1.0/k_fps));
 			}
 
 			director_dispose();
@@ -0,0 +1,160 @@
+#include <cassert>
+
+#include <opencv2/core/hal/intrin.hpp>
+
+#include "mask.hpp"
+
+edge_mask_t::edge_mask_t(): rows(0), cols(0), stride(0)
+{
+}
+
+void edge_mask_t::create(int rows, int cols)
+{
+	this->rows= rows;
+	this->cols= cols;
+	stride= (cols+63)/64;
+	words.resize(rows*stride);
+}
+
+void edge_mask_t::pack(const cv::Mat1b &edge_frame)
+{
+	create(edge_frame.rows, edge_frame.cols);
+
+	for (int y= 0; y<rows; y++)
+	{
+		const uint8_t *edge= edge_frame.ptr<uint8_t>(y);
+		uint64_t *word= &words[y*stride];
+		int x= 0;
+
+		#if CV_SIMD128
+		{
+			const int k_width= cv::v_uint8x16::nlanes;
+			cv::v_uint8x16 zero= cv::v_setzero_u8();
+
+			for (; x+64<=cols; x+= 64)
+			{
+				uint64_t bits= 0;
+
+				for (int lane= 0; lane<64; lane+= k_width)
+				{
+					cv::v_uint8x16 set= cv::v_load(edge+x+lane)!=zero;
+					bits|= static_cast<uint64_t>(cv::v_signmask(set))<<lane;
+				}
+				word[x>>6]= bits;
+			}
+		}
+		#endif
+
+		// scalar tail, or everything when there is no SIMD support
+		for (; x<cols; x+= 64)
+		{
+			uint64_t bits= 0;
+			int end_x= x+64<cols ? x+64 : cols;
+
+			for (int i= x; i<end_x; i++)
+			{
+				bits|= static_cast<uint64_t>(edge[i] ? 1 : 0)<<(i-x);
+			}
+			word[x>>6]= bits;
+		}
+	}
+}
+
+void edge_mask_t::unpack(cv::Mat1b &edge_frame) const
+{
+	edge_frame.create(rows, cols);
+
+	for (int y= 0; y<rows; y++)
+	{
+		const uint64_t *word= &words[y*stride];
+		uint8_t *edge= edge_frame.ptr<uint8_t>(y);
+
+		for (int x= 0; x<cols; x++)
+		{
+			edge[x]= static_cast<uint8_t>(-static_cast<int>((word[x>>6]>>(x&63)) & 1));
+		}
+	}
+}
+
+uint64_t edge_mask_t::last_word_bits() const
+{
+	return cols&63 ? ~0ull>>(64-(cols&63)) : ~0ull;
+}
+
+void edge_mask_t::dilate(edge_mask_t &result) const
+{
+	std::vector<uint64_t> &spread= result.words;
+
+	assert(&result!=this);
+	result.create(rows, cols);
+
+	// horizontally first, each bit ors in its left and right neighbors across word boundaries
+	for (int y= 0; y<rows; y++)
+	{
+		const uint64_t *word= &words[y*stride];
+		uint64_t *spread_word= &spread[y*stride];
+
+		for (int index= 0; index<stride; index++)
+		{
+			uint64_t previous= index>0 ? word[index-1] : 0;
+			uint64_t next= index+1<stride ? word[index+1] : 0;
+
+			spread_word[index]= word[index] | (word[index]<<1) | (previous>>63) | (word[index]>>1) | (next<<63);
+		}
+		spread_word[stride-1]&= last_word_bits();
+	}
+
+	// then vertically in place, keeping the row above before it is overwritten
+	std::vector<uint64_t> &above= result.row_scratch;
+
+	above.assign(stride, 0);
+
+	for (int y= 0; y<rows; y++)
+	{
+		uint64_t *row= &spread[y*stride];
+		const uint64_t *below= y+1<rows ? &spread[(y+1)*stride] : NULL;
+
+		for (int index= 0; index<stride; index++)
+		{
+			uint64_t current= row[index];
+
+			row[index]= current | above[index] | (below ? below[index] : 0);
+			above[index]= current;
+		}
+	}
+}
+
+void edge_mask_t::intersect(const edge_mask_t &mask)
+{
+	assert(mask.rows==rows && mask.cols==cols);
+
+	for (int index= 0; index<words.size(); index++)
+	{
+		words[index]&= mask.words[index];
+	}
+}
+
+int edge_mask_t::count(int y, int begin_x, int end_x) const
+{
+	assert(y>=0 && y<rows && begin_x>=0 && end_x<=cols);
+
+	if (begin_x>=end_x) return 0;
+
+	const uint64_t *word= &words[y*stride];
+	int begin_word= begin_x>>6;
+	int last_word= (end_x-1)>>6;
+	uint64_t begin_bits= ~0ull<<(begin_x&63);
+	uint64_t last_bits= ~0ull>>(63-((end_x-1)&63));
+
+	if (begin_word==last_word)
+	{
+		return mask_popcount(word[begin_word] & begin_bits & last_bits);
+	}
+
+	int result= mask_popcount(word[begin_word] & begin_bits);
+	for (int index= begin_word+1; index<last_word; index++)
+	{
+		result+= mask_popcount(word[index]);
+	}
+	return result + mask_popcount(word[last_word] & last_bits);
+}
@@ -0,0 +1,53 @@
+#ifndef mask_hpp
+#define mask_hpp
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+inline int mask_popcount(uint64_t word)
+{
+	#if defined(_MSC_VER)
+	return static_cast<int>(__popcnt64(word));
+	#else
+	return __builtin_popcountll(word);
+	#endif
+}
+
+// one bit per edge pixel, 640x360 packs into 28 KB so the bee loops keep it in cache.
+// bit x&63 of words[y*stride + (x>>6)] is pixel (y, x)
+class edge_mask_t
+{
+public:
+	edge_mask_t();
+
+	void create(int rows, int cols);
+	void pack(const cv::Mat1b &edge_frame); // nonzero pixels set their bit
+	void unpack(cv::Mat1b &edge_frame) const; // set bits become 255
+
+	void dilate(edge_mask_t &result) const; // 3x3, a bit is set when any of its neighbors is
+	void intersect(const edge_mask_t &mask); // keeps the bits also set in mask, same size
+
+	bool test(int y, int x) const
+	{
+		return (words[y*stride + (x>>6)]>>(x&63)) & 1;
+	}
+
+	int count(int y, int begin_x, int end_x) const; // set bits in row y over [begin_x, end_x)
+
+	int rows, cols;
+	int stride; // words per row
+	std::vector<uint64_t> words;
+
+private:
+	uint64_t last_word_bits() const; // the bits of a row's last word that are inside cols
+
+	std::vector<uint64_t> row_scratch;
+};
+
+#endif /* mask_hpp */
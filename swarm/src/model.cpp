@@ -2,7 +2,11 @@
 #include <string>
 #include <vector>
 
+#include <opencv2/core/ocl.hpp>
+#include <SDL_log.h>
+
 #include "model.hpp"
+#include "timer.hpp"
 
 
 // Initialize the parameters
@@ -16,17 +20,148 @@ const int k_input_height= 416;				// Height of network's input image, Not actual
 const std::string k_classes_filename= "res/gesture.names";
 const std::string k_config_filename= "res/gesture.cfg";
 const std::string k_weights_filename= "res/gesture.weights";
+const std::string k_backend_filename= "res/gesture.backend"; // the probed choice, delete it to probe again
+
+const int k_probe_warmup_count= 2; // the first inferences compile kernels and allocate
+const int k_probe_timed_count= 3;
+
+struct model_backend_t
+{
+	const char *name;
+	cv::dnn::Backend backend;
+	cv::dnn::Target target;
+};
+
+// in order of preference when they tie
+static const model_backend_t k_model_backends[]=
+{
+	{"opencv_cpu", cv::dnn::DNN_BACKEND_OPENCV, cv::dnn::DNN_TARGET_CPU},
+	{"opencv_opencl", cv::dnn::DNN_BACKEND_OPENCV, cv::dnn::DNN_TARGET_OPENCL},
+	{"opencv_opencl_fp16", cv::dnn::DNN_BACKEND_OPENCV, cv::dnn::DNN_TARGET_OPENCL_FP16},
+	{"openvino_cpu", cv::dnn::DNN_BACKEND_INFERENCE_ENGINE, cv::dnn::DNN_TARGET_CPU}
+};
+static const int k_model_backend_count= sizeof(k_model_backends)/sizeof(k_model_backends[0]);
+
+static bool model_backend_available(const model_backend_t &model_backend);
 
 model_t::model_t()
 {
 	//Load names of classes to be detected by model
 	classes= get_class_names();
+	for (int class_index= 0; class_index<classes.size(); class_index++)
+	{
+		class_gestures.push_back(gesture_from_name(classes[class_index].c_str()));
+		if (class_gestures.back()==k_gesture_count)
+		{
+			SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Unknown gesture class %s is ignored", classes[class_index].c_str());
+		}
+	}
 
 	//Load the neural network
 	network= cv::dnn::readNetFromDarknet(k_config_filename, k_weights_filename);
-	network.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV); 
-	// Right now setting to CPU, will have to research if we can leverage GPU if necessary
-	network.setPreferableTarget(cv::dnn::DNN_TARGET_OPENCL);
+	select_backend();
+}
+
+static bool model_backend_available(const model_backend_t &model_backend)
+{
+	std::vector<std::pair<cv::dnn::Backend, cv::dnn::Target>> available= cv::dnn::getAvailableBackends();
+
+	if ((model_backend.target==cv::dnn::DNN_TARGET_OPENCL || model_backend.target==cv::dnn::DNN_TARGET_OPENCL_FP16) && !cv::ocl::haveOpenCL())
+	{
+		return false;
+	}
+
+	for (int index= 0; index<available.size(); index++)
+	{
+		if (available[index].first==model_backend.backend && available[index].second==model_backend.target) return true;
+	}
+	return false;
+}
+
+void model_t::select_backend()
+{
+	std::string cache_key= std::string("opencv ")+CV_VERSION;
+	int selected= -1;
+
+	// the cache is only good for the opencv build that wrote it
+	{
+		std::ifstream in_file(k_backend_filename.c_str());
+		std::string key, name;
+
+		if (std::getline(in_file, key) && std::getline(in_file, name) && key==cache_key)
+		{
+			for (int index= 0; index<k_model_backend_count; index++)
+			{
+				if (name==k_model_backends[index].name && model_backend_available(k_model_backends[index])) selected= index;
+			}
+		}
+	}
+
+	if (selected>=0)
+	{
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Gesture model uses %s from %s", k_model_backends[selected].name, k_backend_filename.c_str());
+	}
+	else
+	{
+		// a few inferences on a blank blob per pair, the fastest wins
+		cv::Mat blob= cv::dnn::blobFromImage(cv::Mat::zeros(k_input_height, k_input_width, CV_8UC3), 1/255.0, cv::Size(k_input_width, k_input_height));
+		double best_time= 0.0;
+
+		for (int index= 0; index<k_model_backend_count; index++)
+		{
+			const model_backend_t &model_backend= k_model_backends[index];
+
+			if (!model_backend_available(model_backend)) continue;
+
+			try
+			{
+				std::vector<cv::Mat> outputs;
+				sdl_timer_t timer;
+
+				network.setPreferableBackend(model_backend.backend);
+				network.setPreferableTarget(model_backend.target);
+				for (int run= 0; run<k_probe_warmup_count+k_probe_timed_count; run++)
+				{
+					if (run==k_probe_warmup_count) timer.reset();
+					network.setInput(blob);
+					network.forward(outputs, get_output_names(network));
+				}
+
+				double time= timer.elapsed()/k_probe_timed_count;
+
+				SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Gesture model on %s takes %.1f ms", model_backend.name, 1000.0*time);
+				if (selected<0 || time<best_time)
+				{
+					selected= index;
+					best_time= time;
+				}
+			}
+			catch (const cv::Exception &exception)
+			{
+				SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Gesture model can't run on %s: %s", model_backend.name, exception.what());
+			}
+		}
+
+		if (selected<0)
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Gesture model runs on no backend, falling back to %s", k_model_backends[0].name);
+			selected= 0;
+		}
+		else
+		{
+			std::ofstream out_file(k_backend_filename.c_str());
+
+			out_file<<cache_key<<"\n"<<k_model_backends[selected].name<<"\n";
+			if (!out_file)
+			{
+				SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "Couldn't write %s", k_backend_filename.c_str());
+			}
+			SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Gesture model uses %s", k_model_backends[selected].name);
+		}
+	}
+
+	network.setPreferableBackend(k_model_backends[selected].backend);
+	network.setPreferableTarget(k_model_backends[selected].target);
 }
 
 void model_t::analyze_frame(const cv::Mat &frame, commands_t &commands)
@@ -98,8 +233,10 @@ std::vector<command_t> model_t::postprocess(const cv::Mat &frame, const std::vec
 		command_t command;
 		int index= indices[i];
 		int object_num = classIds[index];
-		command.name= classes[object_num];
+		if (class_gestures[object_num]==k_gesture_count) continue;
+		command.gesture= class_gestures[object_num];
 		command.confidence= confidences[index];
+		command.frame_age= 0.0f;
 		cv::Rect box= boxes[index];
 		command.bounding_box= cv::Rect(box.x, box.y, box.width, box.height);
 		gestures.push_back(command);
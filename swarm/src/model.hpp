@@ -18,9 +18,11 @@ public:
 	void analyze_frame(const cv::Mat &frame, commands_t &commands);
 
 	std::vector<std::string> classes;
+	std::vector<gesture_t> class_gestures; // classes interned at load, k_gesture_count for unknown ones
 
 private:
 	std::vector<std::string> get_class_names();
+	void select_backend(); // fastest backend and target here, probed once and cached on disk
 
 	cv::dnn::Net network;
 
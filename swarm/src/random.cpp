@@ -0,0 +1,98 @@
+#include <cassert>
+
+#include "random.hpp"
+
+const uint64_t k_random_default_seed= 0x5eed5eed5eed5eedull;
+
+static random_t g_random_streams[k_random_stream_count];
+static uint64_t g_random_master_seed= 0; // keys the block streams
+static bool g_random_seeded= false;
+
+inline uint32_t random_rotate(uint32_t value, int bits)
+{
+	return (value<<bits) | (value>>(32-bits));
+}
+
+// splitmix64, expands the master seed into well mixed stream states
+inline uint64_t random_split(uint64_t &value)
+{
+	uint64_t z= (value+= 0x9e3779b97f4a7c15ull);
+	z= (z^(z>>30))*0xbf58476d1ce4e5b9ull;
+	z= (z^(z>>27))*0x94d049bb133111ebull;
+	return z^(z>>31);
+}
+
+void random_t::seed(uint64_t master_seed, int stream_index)
+{
+	uint64_t value= master_seed^(0xd1b54a32d192ed03ull*(stream_index+1));
+	uint64_t a= random_split(value);
+	uint64_t b= random_split(value);
+
+	state[0]= static_cast<uint32_t>(a);
+	state[1]= static_cast<uint32_t>(a>>32);
+	state[2]= static_cast<uint32_t>(b);
+	state[3]= static_cast<uint32_t>(b>>32);
+}
+
+uint32_t random_t::next()
+{
+	uint32_t result= random_rotate(state[1]*5, 7)*9;
+	uint32_t t= state[1]<<9;
+
+	state[2]^= state[0];
+	state[3]^= state[1];
+	state[1]^= state[2];
+	state[0]^= state[3];
+	state[2]^= t;
+	state[3]= random_rotate(state[3], 11);
+
+	return result;
+}
+
+float random_t::uniform(float minimum, float maximum)
+{
+	// top 24 bits fill the float mantissa exactly
+	float fraction= static_cast<float>(next()>>8)*(1.0f/16777216.0f);
+	return minimum+(maximum-minimum)*fraction;
+}
+
+int random_t::uniform(int count)
+{
+	return static_cast<int>((static_cast<uint64_t>(next())*count)>>32);
+}
+
+void random_seed(uint64_t master_seed)
+{
+	for (int stream_index= 0; stream_index<k_random_stream_count; stream_index++)
+	{
+		g_random_streams[stream_index].seed(master_seed, stream_index);
+	}
+	g_random_master_seed= master_seed;
+	g_random_seeded= true;
+}
+
+random_t &random_stream(int stream_index)
+{
+	assert(stream_index>=0 && stream_index<k_random_stream_count);
+
+	if (!g_random_seeded)
+	{
+		random_seed(k_random_default_seed);
+	}
+
+	return g_random_streams[stream_index];
+}
+
+random_t random_block_stream(int64_t step, int block_index)
+{
+	uint64_t value= static_cast<uint64_t>(step);
+	random_t random;
+
+	if (!g_random_seeded)
+	{
+		random_seed(k_random_default_seed);
+	}
+
+	random.seed(g_random_master_seed^random_split(value), block_index);
+	return random;
+}
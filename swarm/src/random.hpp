@@ -0,0 +1,32 @@
+#ifndef random_hpp
+#define random_hpp
+
+#include <cstdint>
+
+// xoshiro128** stream, small and fast enough to draw from inside the bee loops
+class random_t
+{
+public:
+	void seed(uint64_t master_seed, int stream_index);
+
+	uint32_t next();
+	float uniform(float minimum, float maximum);
+	int uniform(int count); // [0, count)
+
+private:
+	uint32_t state[4];
+};
+
+// reseeds every stream from one master seed, same seed and same input give the same run
+void random_seed(uint64_t master_seed);
+
+const int k_random_simulation_stream= 0; // spawns and removals on the simulation thread
+const int k_random_main_stream= 1; // director on the main thread, outside the simulation
+const int k_random_stream_count= 2;
+
+random_t &random_stream(int stream_index);
+
+// stream for one block of bees on one simulation step, the same whichever worker draws from it
+random_t random_block_stream(int64_t step, int block_index);
+
+#endif /* random_hpp */
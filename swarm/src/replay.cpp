@@ -0,0 +1,222 @@
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <opencv2/imgcodecs.hpp>
+#include <SDL_log.h>
+
+#include "constants.hpp"
+#include "replay.hpp"
+
+static const char k_replay_magic[4]= {'S', 'W', 'R', 'L'};
+static const uint32_t k_replay_version= 1;
+
+struct replay_header_t
+{
+	char magic[4];
+	uint32_t version;
+	uint64_t seed;
+	int32_t edge_width, edge_height;
+	int32_t depth_width, depth_height;
+};
+
+static bool replay_write(const void *data, size_t size);
+static bool replay_read(void *data, size_t size);
+static bool replay_write_image(const cv::Mat &image);
+static bool replay_read_image(cv::Mat &image, int flags);
+
+static FILE *g_recorder_file= NULL;
+static FILE *g_replayer_file= NULL;
+static std::vector<uint8_t> g_replay_buffer;
+static int g_replay_frame_count= 0;
+static char g_replay_name[64];
+
+bool recorder_open(const char *filepath, uint64_t seed)
+{
+	replay_header_t header;
+
+	g_recorder_file= std::fopen(filepath, "wb");
+	if (!g_recorder_file)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't create recording %s", filepath);
+		return false;
+	}
+
+	std::memcpy(header.magic, k_replay_magic, sizeof(header.magic));
+	header.version= k_replay_version;
+	header.seed= seed;
+	header.edge_width= k_edge_width;
+	header.edge_height= k_edge_height;
+	header.depth_width= k_camera_width;
+	header.depth_height= k_camera_height;
+	g_replay_frame_count= 0;
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Recording to %s", filepath);
+
+	return replay_write(&header, sizeof(header));
+}
+
+void recorder_close()
+{
+	if (g_recorder_file)
+	{
+		std::fclose(g_recorder_file);
+		g_recorder_file= NULL;
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Recorded %d frames", g_replay_frame_count);
+	}
+}
+
+bool recorder_write(const cv::Mat1b &edge_frame, const cv::Mat1w &depth_frame, const commands_t &commands)
+{
+	bool success= g_recorder_file!=NULL;
+	uint32_t command_count= static_cast<uint32_t>(commands.size());
+
+	success= success && replay_write_image(edge_frame);
+	success= success && replay_write_image(depth_frame);
+	success= success && replay_write(&command_count, sizeof(command_count));
+	for (int command_index= 0; success && command_index<commands.size(); command_index++)
+	{
+		// gestures are stored by name, so logs survive changes to the gesture enum
+		const command_t &command= commands[command_index];
+		const char *name= k_gesture_names[command.gesture];
+		uint32_t name_length= static_cast<uint32_t>(std::strlen(name));
+		int32_t box[4]= {command.bounding_box.x, command.bounding_box.y, command.bounding_box.width, command.bounding_box.height};
+
+		success= replay_write(&name_length, sizeof(name_length)) &&
+			replay_write(name, name_length) &&
+			replay_write(box, sizeof(box)) &&
+			replay_write(&command.confidence, sizeof(command.confidence));
+	}
+
+	if (success)
+	{
+		g_replay_frame_count++;
+	}
+	else if (g_recorder_file)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't write recording, stopping it");
+		recorder_close();
+	}
+
+	return success;
+}
+
+bool replayer_open(const char *filepath, uint64_t &seed)
+{
+	replay_header_t header;
+
+	g_replayer_file= std::fopen(filepath, "rb");
+	if (!g_replayer_file)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't open recording %s", filepath);
+		return false;
+	}
+
+	if (!replay_read(&header, sizeof(header)) ||
+		std::memcmp(header.magic, k_replay_magic, sizeof(header.magic))!=0 ||
+		header.version!=k_replay_version ||
+		header.edge_width!=k_edge_width || header.edge_height!=k_edge_height ||
+		header.depth_width!=k_camera_width || header.depth_height!=k_camera_height)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s is not a recording this build can replay", filepath);
+		replayer_close();
+		return false;
+	}
+
+	seed= header.seed;
+	g_replay_frame_count= 0;
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Replaying %s", filepath);
+
+	return true;
+}
+
+void replayer_close()
+{
+	if (g_replayer_file)
+	{
+		std::fclose(g_replayer_file);
+		g_replayer_file= NULL;
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Replayed %d frames", g_replay_frame_count);
+	}
+}
+
+bool replayer_read(cv::Mat1b &edge_frame, cv::Mat1w &depth_frame, commands_t &commands)
+{
+	cv::Mat edge_image, depth_image;
+	uint32_t command_count= 0;
+
+	if (!g_replayer_file ||
+		!replay_read_image(edge_image, cv::IMREAD_GRAYSCALE) ||
+		!replay_read_image(depth_image, cv::IMREAD_ANYDEPTH) ||
+		!replay_read(&command_count, sizeof(command_count)))
+	{
+		return false;
+	}
+
+	commands.clear();
+	for (int command_index= 0; command_index<command_count; command_index++)
+	{
+		command_t command;
+		uint32_t name_length= 0;
+		int32_t box[4];
+
+		if (!replay_read(&name_length, sizeof(name_length)) || name_length>=sizeof(g_replay_name)) return false;
+		g_replay_name[name_length]= '\0';
+		if (!replay_read(g_replay_name, name_length) ||
+			!replay_read(box, sizeof(box)) ||
+			!replay_read(&command.confidence, sizeof(command.confidence)))
+		{
+			return false;
+		}
+		command.bounding_box= cv::Rect(box[0], box[1], box[2], box[3]);
+		command.gesture= gesture_from_name(g_replay_name);
+		command.frame_age= 0.0f;
+		if (command.gesture<k_gesture_count)
+		{
+			commands.push_back(command);
+		}
+	}
+
+	edge_frame= edge_image;
+	depth_frame= depth_image;
+	g_replay_frame_count++;
+
+	return true;
+}
+
+static bool replay_write(const void *data, size_t size)
+{
+	return size==0 || std::fwrite(data, size, 1, g_recorder_file)==1;
+}
+
+static bool replay_read(void *data, size_t size)
+{
+	return size==0 || std::fread(data, size, 1, g_replayer_file)==1;
+}
+
+// png is lossless for both the binary edge frame and the 16 bit depth, and fast at low compression
+static bool replay_write_image(const cv::Mat &image)
+{
+	const std::vector<int> parameters= {cv::IMWRITE_PNG_COMPRESSION, 1};
+	uint32_t size;
+
+	if (!cv::imencode(".png", image, g_replay_buffer, parameters)) return false;
+
+	size= static_cast<uint32_t>(g_replay_buffer.size());
+
+	return replay_write(&size, sizeof(size)) && replay_write(g_replay_buffer.data(), size);
+}
+
+static bool replay_read_image(cv::Mat &image, int flags)
+{
+	uint32_t size= 0;
+
+	if (!replay_read(&size, sizeof(size))) return false;
+	g_replay_buffer.resize(size);
+	if (!replay_read(g_replay_buffer.data(), size)) return false;
+
+	image= cv::imdecode(g_replay_buffer, flags);
+
+	return !image.empty();
+}
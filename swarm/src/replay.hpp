@@ -0,0 +1,20 @@
+#ifndef replay_hpp
+#define replay_hpp
+
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+#include "gesture.hpp"
+
+// binary log of everything the swarm consumed each frame. a header with the random seed, then per frame
+// the edge and depth frames as png and the gesture commands. native byte order, not meant to travel
+bool recorder_open(const char *filepath, uint64_t seed);
+void recorder_close();
+bool recorder_write(const cv::Mat1b &edge_frame, const cv::Mat1w &depth_frame, const commands_t &commands);
+
+bool replayer_open(const char *filepath, uint64_t &seed);
+void replayer_close();
+bool replayer_read(cv::Mat1b &edge_frame, cv::Mat1w &depth_frame, commands_t &commands); // false at the end of the log
+
+#endif /* replay_hpp */
@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <SDL_log.h>
+
+#include "constants.hpp"
+#include "simulation.hpp"
+#include "timer.hpp"
+#include "trace.hpp"
+
+const double k_simulation_maximum_lag= 0.25; // seconds, older backlog is dropped instead of caught up
+
+static void simulation_thread_function();
+static bool simulation_step(double time);
+
+static swarm_t g_simulation_swarm;
+static std::thread *g_simulation_thread= NULL;
+static sdl_timer_t g_simulation_clock;
+static bool g_simulation_lockstep= false;
+static int64_t g_simulation_lockstep_step= 0;
+
+// input as seen by the step, only touched by the thread that steps
+static edge_mask_t g_simulation_step_edge_mask;
+static cv::Mat1i g_simulation_step_edge_counts;
+static commands_t g_simulation_step_commands;
+static int g_simulation_step_input_generation= 0;
+static int g_simulation_step_edge_generation= 0;
+static std::vector<simulation_command_t> g_simulation_step_posted;
+
+// everything below is guarded by the mutex
+static std::mutex g_simulation_mutex;
+static bool g_simulation_running= false;
+
+static edge_mask_t g_simulation_edge_mask;
+static cv::Mat1i g_simulation_edge_counts;
+static commands_t g_simulation_commands;
+static int g_simulation_input_generation= 0;
+static int g_simulation_edge_generation= 0; // bumped only when the edges change
+static std::vector<simulation_command_t> g_simulation_posted;
+
+// triple buffer, the simulation thread fills back while rendering reads previous and current
+static swarm_frame_t g_simulation_frames[3];
+static int g_simulation_previous= 0;
+static int g_simulation_current= 1;
+static int g_simulation_back= 2;
+
+bool simulation_initialize(bool lockstep)
+{
+	g_simulation_swarm.reset();
+	g_simulation_frames[g_simulation_previous].capture(g_simulation_swarm, 0.0);
+	g_simulation_frames[g_simulation_current].capture(g_simulation_swarm, 0.0);
+
+	g_simulation_clock.reset();
+	g_simulation_running= true;
+	g_simulation_lockstep= lockstep;
+	g_simulation_lockstep_step= 0;
+	if (!lockstep)
+	{
+		g_simulation_thread= new std::thread(simulation_thread_function);
+	}
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Started simulation at %d Hz%s", k_simulation_rate, lockstep ? " in lockstep" : "");
+
+	return true;
+}
+
+void simulation_dispose()
+{
+	g_simulation_mutex.lock();
+	g_simulation_running= false;
+	g_simulation_mutex.unlock();
+
+	if (g_simulation_thread)
+	{
+		g_simulation_thread->join();
+		delete g_simulation_thread;
+		g_simulation_thread= NULL;
+	}
+}
+
+void simulation_submit(const edge_mask_t &edge_mask, const cv::Mat1i &edge_counts, const commands_t &commands, bool edges_changed)
+{
+	std::lock_guard<std::mutex> lock(g_simulation_mutex);
+
+	if (edges_changed)
+	{
+		g_simulation_edge_mask= edge_mask;
+		edge_counts.copyTo(g_simulation_edge_counts);
+		g_simulation_edge_generation++;
+	}
+	g_simulation_commands= commands;
+	g_simulation_input_generation++;
+}
+
+void simulation_post(const simulation_command_t &command)
+{
+	std::lock_guard<std::mutex> lock(g_simulation_mutex);
+
+	g_simulation_posted.push_back(command);
+}
+
+void simulation_advance(int step_count)
+{
+	assert(g_simulation_lockstep);
+
+	for (int step_index= 0; step_index<step_count; step_index++)
+	{
+		g_simulation_lockstep_step++;
+		simulation_step(g_simulation_lockstep_step*static_cast<double>(k_dt));
+	}
+}
+
+void simulation_interpolate(swarm_frame_t &frame)
+{
+	double display_time= g_simulation_clock.elapsed()-k_dt;
+	std::lock_guard<std::mutex> lock(g_simulation_mutex);
+	const swarm_frame_t &previous= g_simulation_frames[g_simulation_previous];
+	const swarm_frame_t &current= g_simulation_frames[g_simulation_current];
+	double span= current.time-previous.time;
+	float alpha= span>0.0 && !g_simulation_lockstep ? static_cast<float>((display_time-previous.time)/span) : 1.0f;
+
+	frame.interpolate(previous, current, std::min(std::max(alpha, 0.0f), 1.0f));
+}
+
+static void simulation_thread_function()
+{
+	int64_t step= 0;
+
+	trace_thread("simulation");
+
+	while (true)
+	{
+		// fixed step, sleep until the next one is due
+		double now= g_simulation_clock.elapsed();
+		double due= (step+1)*static_cast<double>(k_dt);
+
+		if (now<due)
+		{
+			std::this_thread::sleep_for(std::chrono::duration<double>(due-now));
+			continue;
+		}
+		if (now-due>k_simulation_maximum_lag)
+		{
+			step= static_cast<int64_t>(now/k_dt)-1;
+			due= (step+1)*static_cast<double>(k_dt);
+		}
+
+		if (!simulation_step(due)) break;
+		step++;
+	}
+}
+
+// one fixed step on whichever thread owns the simulation, false once it has been stopped
+static bool simulation_step(double time)
+{
+	// pick up new input and posted commands
+	{
+		std::lock_guard<std::mutex> lock(g_simulation_mutex);
+
+		if (!g_simulation_running) return false;
+
+		if (g_simulation_step_input_generation!=g_simulation_input_generation)
+		{
+			if (g_simulation_step_edge_generation!=g_simulation_edge_generation)
+			{
+				g_simulation_step_edge_mask= g_simulation_edge_mask;
+				g_simulation_edge_counts.copyTo(g_simulation_step_edge_counts);
+				g_simulation_step_edge_generation= g_simulation_edge_generation;
+			}
+			g_simulation_step_commands= g_simulation_commands;
+			g_simulation_step_input_generation= g_simulation_input_generation;
+		}
+		g_simulation_step_posted.swap(g_simulation_posted);
+	}
+
+	for (int command_index= 0; command_index<g_simulation_step_posted.size(); command_index++)
+	{
+		g_simulation_step_posted[command_index](g_simulation_swarm);
+	}
+	g_simulation_step_posted.clear();
+
+	if (g_simulation_step_edge_generation==0) return true; // nothing to land on yet
+
+	trace_begin("step");
+	g_simulation_swarm.update(g_simulation_step_edge_mask, g_simulation_step_edge_counts, g_simulation_step_commands);
+	trace_end("step");
+
+	// publish, the oldest frame becomes the next back buffer
+	g_simulation_frames[g_simulation_back].capture(g_simulation_swarm, time);
+	{
+		std::lock_guard<std::mutex> lock(g_simulation_mutex);
+		int oldest= g_simulation_previous;
+
+		g_simulation_previous= g_simulation_current;
+		g_simulation_current= g_simulation_back;
+		g_simulation_back= oldest;
+	}
+
+	return true;
+}
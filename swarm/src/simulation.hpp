@@ -0,0 +1,32 @@
+#ifndef simulation_hpp
+#define simulation_hpp
+
+#include <functional>
+
+#include <opencv2/core.hpp>
+
+#include "gesture.hpp"
+#include "mask.hpp"
+#include "swarm.hpp"
+
+typedef std::function<void(swarm_t &swarm)> simulation_command_t;
+
+// runs the swarm on its own thread at k_simulation_rate, independent of the render rate.
+// in lockstep there is no thread, the caller steps it with simulation_advance so runs are repeatable
+bool simulation_initialize(bool lockstep);
+void simulation_dispose();
+
+// latest camera input, the simulation keeps stepping on it until the next submit.
+// without edges_changed only the commands are taken, the edges from before stay
+void simulation_submit(const edge_mask_t &edge_mask, const cv::Mat1i &edge_counts, const commands_t &commands, bool edges_changed= true);
+
+// runs command on the simulation thread before its next step, the only safe way to change the swarm
+void simulation_post(const simulation_command_t &command);
+
+// lockstep only, runs step_count steps on the calling thread
+void simulation_advance(int step_count);
+
+// fills frame with the swarm one step behind now, interpolated between the last two published steps
+void simulation_interpolate(swarm_frame_t &frame);
+
+#endif /* simulation_hpp */
@@ -1,11 +1,12 @@
+#include <algorithm>
 #include <cmath>
-#include <cstdlib>
-#include <queue>
+#include <vector>
 
+#include "config.hpp"
 #include "constants.hpp"
+#include "random.hpp"
 #include "swarm.hpp"
-
-const float k_tau= 6.2831853f;
+#include "workers.hpp"
 
 const float k_timer_minimum= 0.2f;
 const float k_timer_maximum= 0.8f;
@@ -18,21 +19,34 @@ const float k_fly_speed_maximum= 300.0f;
 
 const float k_spin_maximum= 0.5f*k_tau;
 
-const int k_field_width= k_simulation_width/24;
-const int k_field_height= k_simulation_height/24;
+const float k_separation_distance= 2.0f*k_bee_radius; // sprites touch
+const float k_separation_speed= 60.0f; // pixels per second at full overlap
+const int k_separation_neighbor_maximum= 16; // bounds the work per bee inside dense piles
+
+// what each gesture makes the swarm do, NULL leaves the bees landing on edges
+static const swarm_t::behavior_t k_swarm_behaviors[k_gesture_count]=
+{
+	NULL, // longhorn
+	&swarm_t::update_draw, // peace
+	&swarm_t::update_palm, // palm
+	NULL, // fist
+	NULL, // thumbsup
+	NULL, // left
+	NULL, // right
+	NULL // fingerscrossed
+};
+
+const int k_sort_period= 60; // steps between sorting the bees into grid cell order
+
+const int k_slice_alignment= 16; // bees, keeps worker slices on separate cache lines and whole random blocks
 
 static int last_draw_x= -1;
 static int last_draw_y= -1;
 
 static int last_count= 0;
 
-static int edge_force_radius= 25;
-
-inline float uniform_random(float minimum, float maximum)
-{
-	double fraction= static_cast<double>(rand())/RAND_MAX;
-	return minimum+(maximum-minimum)*static_cast<float>(fraction);
-}
+const int k_edge_force_radius= 25;
+const int k_draw_landed_max= 500; // more than a cell can count, strokes never turn bees away
 
 inline float wrap_value(float value, float maximum, float gutter)
 {
@@ -41,52 +55,247 @@ inline float wrap_value(float value, float maximum, float gutter)
 	return value;
 }
 
-bee_t::bee_t()
+static void bee_spawn(bees_t &bees, int bee_index, random_t &random)
 {
-	float edge_position= uniform_random(0.0f, k_simulation_width+k_simulation_height+4.0f*k_bee_radius);
-	bool top_edge= edge_position<k_simulation_width+2.0f*k_bee_radius;
-
-	state= _idle;
-	timer= 0.0f;
-	x= top_edge ? edge_position-k_bee_radius : -k_bee_radius;
-	y= top_edge ? -k_bee_radius : edge_position-k_simulation_width-3.0f*k_bee_radius;
-	assert(x>=-k_bee_radius && x<k_simulation_width+k_bee_radius);
-	assert(y>=-k_bee_radius && y<k_simulation_height+k_bee_radius);
-	facing= uniform_random(0.0f, k_tau);
-	speed= 0.0f;
-	spin= 0.0f;
+	float edge_position= random.uniform(0.0f, g_config.simulation_width+g_config.simulation_height+4.0f*k_bee_radius);
+	bool top_edge= edge_position<g_config.simulation_width+2.0f*k_bee_radius;
+
+	bees.state[bee_index]= bees_t::_idle;
+	bees.timer[bee_index]= 0.0f;
+	bees.x[bee_index]= top_edge ? edge_position-k_bee_radius : -k_bee_radius;
+	bees.y[bee_index]= top_edge ? -k_bee_radius : edge_position-g_config.simulation_width-3.0f*k_bee_radius;
+	assert(bees.x[bee_index]>=-k_bee_radius && bees.x[bee_index]<g_config.simulation_width+k_bee_radius);
+	assert(bees.y[bee_index]>=-k_bee_radius && bees.y[bee_index]<g_config.simulation_height+k_bee_radius);
+	bees.facing[bee_index]= random.uniform(0.0f, k_tau);
+	bees.speed[bee_index]= 0.0f;
+	bees.spin[bee_index]= 0.0f;
 }
 
-void bee_t::update(const cv::Mat1b &edge_frame, int landed_max, cv::Mat1b &landed, const cv::Mat1f *flow)
+// exact nearest nonzero seed for every cell in two linear passes, felzenszwalb & huttenlocher's
+// distance transform with the argmin tracked. nearest holds the seed (x, y), or -1 without seeds
+static void nearest_seed_transform(const cv::Mat1b &seeds, cv::Mat2s &nearest)
 {
-	float fraction_y= y/k_simulation_height;
-	float fraction_x= x/k_simulation_width;
-	int edge_y= static_cast<int>(fraction_y*edge_frame.rows);
-	int edge_x= static_cast<int>(fraction_x*edge_frame.cols);
-	int landed_y= static_cast<int>(fraction_y*landed.rows);
-	int landed_x= static_cast<int>(fraction_x*landed.cols);
+	const int k_none= -1;
+	const double k_infinity= 1e20;
+	int rows= seeds.rows;
+	int cols= seeds.cols;
+	std::vector<int> column_seed(rows*cols); // y of the nearest seed in the same column
+	std::vector<double> distance(cols);
+	std::vector<int> parabola(cols);
+	std::vector<double> boundary(cols+1);
+
+	nearest.create(rows, cols);
+
+	// vertical pass
+	for (int x= 0; x<cols; x++)
+	{
+		int last= k_none;
 
-	// update state, speed, and spin
-	if (x>=0 && x<k_simulation_width &&
-		y>=0 && y<k_simulation_height &&
-		edge_frame(edge_y, edge_x)>0 &&
-		landed(landed_y, landed_x)<landed_max)
+		for (int y= 0; y<rows; y++)
+		{
+			if (seeds(y, x)) last= y;
+			column_seed[y*cols+x]= last;
+		}
+
+		last= k_none;
+		for (int y= rows-1; y>=0; y--)
+		{
+			if (seeds(y, x)) last= y;
+
+			int above= column_seed[y*cols+x];
+			if (last!=k_none && (above==k_none || last-y<y-above))
+			{
+				column_seed[y*cols+x]= last;
+			}
+		}
+	}
+
+	// horizontal pass, lower envelope of the parabolas rooted at each column's nearest seed
+	for (int y= 0; y<rows; y++)
 	{
-		landed(landed_y, landed_x)+= 1;
+		int k= -1;
 
-		if (state==_flying || (state==_crawling && timer<0.0f))
+		for (int x= 0; x<cols; x++)
 		{
-			state= _idle;
-			timer= uniform_random(k_timer_minimum, k_timer_maximum);
+			int seed_y= column_seed[y*cols+x];
+
+			distance[x]= seed_y==k_none ? k_infinity : static_cast<double>((y-seed_y)*(y-seed_y));
+			if (seed_y==k_none) continue;
+
+			while (k>=0)
+			{
+				int p= parabola[k];
+				double s= ((distance[x]+x*x) - (distance[p]+p*p))/(2.0*(x-p));
+
+				if (s<=boundary[k])
+				{
+					k--;
+				}
+				else
+				{
+					k++;
+					parabola[k]= x;
+					boundary[k]= s;
+					boundary[k+1]= k_infinity;
+					break;
+				}
+			}
+
+			if (k<0)
+			{
+				k= 0;
+				parabola[0]= x;
+				boundary[0]= -k_infinity;
+				boundary[1]= k_infinity;
+			}
+		}
+
+		for (int x= 0, j= 0; x<cols; x++)
+		{
+			if (k<0)
+			{
+				nearest(y, x)= cv::Vec2s(k_none, k_none);
+				continue;
+			}
+
+			while (boundary[j+1]<x) j++;
+
+			int seed_x= parabola[j];
+			nearest(y, x)= cv::Vec2s(static_cast<short>(seed_x), static_cast<short>(column_seed[y*cols+seed_x]));
+		}
+	}
+}
+
+// push apart from overlapping neighbors, reading positions from the grid so slices can run in parallel.
+// only flying bees move, bees on an edge would be pushed off their pixels and land again every step
+static void bee_separate(bees_t &bees, int bee_index, const grid_t &grid)
+{
+	if (bees.state[bee_index]!=bees_t::_flying) return;
+
+	float x= bees.x[bee_index];
+	float y= bees.y[bee_index];
+	float push_x= 0.0f;
+	float push_y= 0.0f;
+	int neighbor_count= 0;
+	int cell_x, cell_y;
+
+	grid.cell(x, y, cell_x, cell_y);
+	for (int j= std::max(cell_y-1, 0); j<=std::min(cell_y+1, grid.rows-1); j++)
+	{
+		for (int i= std::max(cell_x-1, 0); i<=std::min(cell_x+1, grid.cols-1); i++)
+		{
+			int cell= j*grid.cols+i;
+
+			for (int k= grid.cell_starts[cell]; k<grid.cell_starts[cell+1] && neighbor_count<k_separation_neighbor_maximum; k++)
+			{
+				float dx= x-grid.x[k];
+				float dy= y-grid.y[k];
+				float distance_squared= dx*dx + dy*dy;
+
+				if (grid.order[k]==bee_index || distance_squared>=k_separation_distance*k_separation_distance) continue;
+
+				float distance= std::sqrt(distance_squared);
+				float overlap= (k_separation_distance-distance)/k_separation_distance;
+
+				// coincident bees split along their index order
+				if (distance>0.0f)
+				{
+					push_x+= overlap*dx/distance;
+					push_y+= overlap*dy/distance;
+				}
+				else
+				{
+					push_x+= grid.order[k]<bee_index ? overlap : -overlap;
+				}
+				neighbor_count++;
+			}
+		}
+	}
+
+	if (neighbor_count>0)
+	{
+		bees.x[bee_index]= x + push_x*k_separation_speed*k_dt;
+		bees.y[bee_index]= y + push_y*k_separation_speed*k_dt;
+	}
+}
+
+// contiguous slice of the bees stepped by one worker
+static void bee_slice(int bee_count, int worker_index, int worker_count, int &begin, int &end)
+{
+	begin= (bee_count*worker_index/worker_count) & ~(k_slice_alignment-1);
+	end= worker_index+1<worker_count ? (bee_count*(worker_index+1)/worker_count) & ~(k_slice_alignment-1) : bee_count;
+}
+
+// landed cell under a bee that is over an edge pixel, -1 anywhere else
+static int bee_edge_cell(const bees_t &bees, int bee_index, const edge_mask_t &edge_mask, const cv::Mat1b &landed)
+{
+	float x= bees.x[bee_index];
+	float y= bees.y[bee_index];
+
+	if (x<0 || x>=g_config.simulation_width || y<0 || y>=g_config.simulation_height) return -1;
+
+	float fraction_y= y/g_config.simulation_height;
+	float fraction_x= x/g_config.simulation_width;
+
+	if (!edge_mask.test(static_cast<int>(fraction_y*edge_mask.rows), static_cast<int>(fraction_x*edge_mask.cols))) return -1;
+	return static_cast<int>(fraction_y*landed.rows)*landed.cols + static_cast<int>(fraction_x*landed.cols);
+}
+
+// landed cell under a bee that is over a visible stroke pixel, -1 anywhere else
+static int bee_canvas_cell(const bees_t &bees, int bee_index, const canvas_t &canvas, const cv::Mat1b &landed)
+{
+	float x= bees.x[bee_index];
+	float y= bees.y[bee_index];
+
+	if (x<0.0f || x>=g_config.simulation_width || y<0.0f || y>=g_config.simulation_height) return -1;
+
+	float fraction_y= y/g_config.simulation_height;
+	float fraction_x= x/g_config.simulation_width;
+
+	if (!canvas.visible(static_cast<int>(fraction_y*canvas.rows), static_cast<int>(fraction_x*canvas.cols))) return -1;
+	return static_cast<int>(fraction_y*landed.rows)*landed.cols + static_cast<int>(fraction_x*landed.cols);
+}
+
+// counts one more bee on the cell, saturating, and tells whether the bees before it left room under landed_max
+inline bool landed_claim(uint8_t *counts, int cell, int landed_max)
+{
+	bool room= counts[cell]<landed_max;
+
+	if (counts[cell]<UINT8_MAX) counts[cell]++;
+	return room;
+}
+
+// the bee_*_update functions only advance the state machine, bees_t::integrate moves the bees afterwards
+
+// landing is true over an edge pixel whose cell still had room for this bee
+static void bee_update(bees_t &bees, int bee_index, random_t &random, bool landing, const cv::Mat2f *flow)
+{
+	uint8_t &state= bees.state[bee_index];
+	float &timer= bees.timer[bee_index];
+	float &speed= bees.speed[bee_index];
+	float &spin= bees.spin[bee_index];
+	float x= bees.x[bee_index];
+	float y= bees.y[bee_index];
+	float facing= bees.facing[bee_index];
+	float fraction_y= y/g_config.simulation_height;
+	float fraction_x= x/g_config.simulation_width;
+
+	// update state, speed, and spin
+	if (landing)
+	{
+		if (state==bees_t::_flying || (state==bees_t::_crawling && timer<0.0f))
+		{
+			state= bees_t::_idle;
+			timer= random.uniform(k_timer_minimum, k_timer_maximum);
 			speed= 0.0f;
 			spin= 0.0f;
 		}
-		else if (state==_idle && timer<0.0f)
+		else if (state==bees_t::_idle && timer<0.0f)
 		{
-			state= _crawling;
-			timer= uniform_random(k_timer_minimum, k_timer_maximum);
-			speed= uniform_random(k_walk_speed_minimum, k_walk_speed_maximum);
-			spin= uniform_random(-k_spin_maximum, k_spin_maximum);
+			state= bees_t::_crawling;
+			timer= random.uniform(k_timer_minimum, k_timer_maximum);
+			speed= random.uniform(k_walk_speed_minimum, k_walk_speed_maximum);
+			spin= random.uniform(-k_spin_maximum, k_spin_maximum);
 		}
 		else
 		{
@@ -95,28 +304,32 @@ void bee_t::update(const cv::Mat1b &edge_frame, int landed_max, cv::Mat1b &lande
 	}
 	else
 	{
-		if (state!=_flying || timer<0.0f)
+		if (state!=bees_t::_flying || timer<0.0f)
 		{
-			state= _flying;
-			timer= uniform_random(k_timer_minimum, k_timer_maximum);
-			speed= uniform_random(k_fly_speed_minimum, k_fly_speed_maximum);
+			state= bees_t::_flying;
+			timer= random.uniform(k_timer_minimum, k_timer_maximum);
+			speed= random.uniform(k_fly_speed_minimum, k_fly_speed_maximum);
+			cv::Vec2f desired(0.0f, 0.0f);
+
 			if (flow && 
-				x>=0 && x<k_simulation_width &&
-				y>=0 && y<k_simulation_height)
+				x>=0 && x<g_config.simulation_width &&
+				y>=0 && y<g_config.simulation_height)
 			{
 				int flow_y= static_cast<int>(fraction_y*flow->rows);
 				int flow_x= static_cast<int>(fraction_x*flow->cols);
-				float desired_facing= (*flow)(flow_y, flow_x);
-				float delta= desired_facing - facing;
+				desired= (*flow)(flow_y, flow_x);
+			}
 
-				if (delta>0.5*k_tau) delta-= k_tau;
-				else if (delta<-0.5*k_tau) delta+= k_tau;
+			if (desired[0]!=0.0f || desired[1]!=0.0f)
+			{
+				// turn toward the side the desired direction lies on
+				float cross= std::cos(facing)*desired[1] - std::sin(facing)*desired[0];
 
-				spin= delta>0 ? uniform_random(0.0f, k_spin_maximum) : uniform_random(-k_spin_maximum, 0.0f);
+				spin= cross>0 ? random.uniform(0.0f, k_spin_maximum) : random.uniform(-k_spin_maximum, 0.0f);
 			}
 			else
 			{
-				spin= uniform_random(-k_spin_maximum, k_spin_maximum);
+				spin= random.uniform(-k_spin_maximum, k_spin_maximum);
 			}
 		}
 		else
@@ -124,43 +337,37 @@ void bee_t::update(const cv::Mat1b &edge_frame, int landed_max, cv::Mat1b &lande
 			timer-= k_dt;
 		}
 	}
-
-	// update position and facing
-	x= wrap_value(x+speed*cos(facing)*k_dt, k_simulation_width, k_bee_radius);
-	y= wrap_value(y+speed*sin(facing)*k_dt, k_simulation_height, k_bee_radius);
-	facing= wrap_value(facing+spin*k_dt, k_tau, 0.0f);
 }
 
-void bee_t::draw_update(const cv::Mat1f &edge_frame, int landed_max, cv::Mat1b &landed, const cv::Mat2f &force)
+// on_stroke is true over a visible stroke pixel, room when its cell was not yet crowded before this bee
+static void bee_draw_update(bees_t &bees, int bee_index, random_t &random, bool on_stroke, bool room, const cv::Mat2f &force)
 {
-	float fraction_y= y/k_simulation_height;
-	float fraction_x= x/k_simulation_width;
-	int edge_y= static_cast<int>(fraction_y*edge_frame.rows);
-	int edge_x= static_cast<int>(fraction_x*edge_frame.cols);
-	int landed_y= static_cast<int>(fraction_y*landed.rows);
-	int landed_x= static_cast<int>(fraction_x*landed.cols);
-	bool edge_move= false;
+	uint8_t &state= bees.state[bee_index];
+	float &timer= bees.timer[bee_index];
+	float &facing= bees.facing[bee_index];
+	float &speed= bees.speed[bee_index];
+	float &spin= bees.spin[bee_index];
+	float x= bees.x[bee_index];
+	float y= bees.y[bee_index];
 	// update state, speed, and rotation
 	// if on edge
-	if (x>=0.0f && x<k_simulation_width &&
-		y>=0.0f && y<k_simulation_height &&
-		edge_frame(edge_y, edge_x)>0.01f)
+	if (on_stroke)
 	{	//on edge and also no crowd on the same edge
-		if (landed(landed_y, landed_x)<landed_max)
+		if (room)
 		{
-			if (state==_flying || (state==_crawling&&timer<0.0f))
+			if (state==bees_t::_flying || (state==bees_t::_crawling&&timer<0.0f))
 			{
-				state= _idle;
-				timer= uniform_random(k_timer_minimum, k_timer_maximum);
+				state= bees_t::_idle;
+				timer= random.uniform(k_timer_minimum, k_timer_maximum);
 				speed= 0.0f;
 				spin= 0.0f;
 			}
-			else if (state==_idle&&timer<0.0f)
+			else if (state==bees_t::_idle&&timer<0.0f)
 			{
-				state= _crawling;
-				timer= uniform_random(k_timer_minimum, k_timer_maximum);
-				speed= uniform_random(k_walk_speed_minimum, k_walk_speed_maximum);
-				spin= uniform_random(-k_spin_maximum, k_spin_maximum);
+				state= bees_t::_crawling;
+				timer= random.uniform(k_timer_minimum, k_timer_maximum);
+				speed= random.uniform(k_walk_speed_minimum, k_walk_speed_maximum);
+				spin= random.uniform(-k_spin_maximum, k_spin_maximum);
 			}
 			else
 			{
@@ -170,26 +377,25 @@ void bee_t::draw_update(const cv::Mat1f &edge_frame, int landed_max, cv::Mat1b &
 		//on edge but its crowded so fly
 		else
 		{
-			state= _flying;
-			timer= uniform_random(k_timer_minimum, k_timer_maximum);
-			speed= uniform_random(k_fly_speed_minimum, k_fly_speed_maximum);
+			state= bees_t::_flying;
+			timer= random.uniform(k_timer_minimum, k_timer_maximum);
+			speed= random.uniform(k_fly_speed_minimum, k_fly_speed_maximum);
 		}
-		landed(landed_y, landed_x)+= 1;
 	}
 	//not on edge
 	else
 	{
-		if (state!=_flying || timer<0.0f)
+		if (state!=bees_t::_flying || timer<0.0f)
 		{
-			state= _flying;
-			timer= uniform_random(k_timer_minimum, k_timer_maximum);
-			speed= uniform_random(k_fly_speed_minimum, k_fly_speed_maximum);
-			spin= uniform_random(-k_spin_maximum, k_spin_maximum);
+			state= bees_t::_flying;
+			timer= random.uniform(k_timer_minimum, k_timer_maximum);
+			speed= random.uniform(k_fly_speed_minimum, k_fly_speed_maximum);
+			spin= random.uniform(-k_spin_maximum, k_spin_maximum);
 		}
 		else
 		{//not on edge and is still flying	
-			int i= static_cast<int>(y/k_simulation_height*force.rows);
-			int j= static_cast<int>(x/k_simulation_width*force.cols);
+			int i= static_cast<int>(y/g_config.simulation_height*force.rows);
+			int j= static_cast<int>(x/g_config.simulation_width*force.cols);
 
 			if (i>0 && i<force.rows && j>0 && j<force.cols)
 			{
@@ -197,143 +403,297 @@ void bee_t::draw_update(const cv::Mat1f &edge_frame, int landed_max, cv::Mat1b &
 				float dy= force(i, j)[0];
 				if (dx!=0 || dy!=0)
 				{
+					// steer toward the attracting edge before moving, integration then adds the usual spin
 					spin= atan2(dy, dx);
-					edge_move= true;
+					facing= wrap_value(0.2f*facing+spin, k_tau, 0.0f);
 				}
 			}
 			timer-= k_dt;
 		}
 	}
+}
+
+static void bee_palm_update(bees_t &bees, int bee_index, random_t &random, float center_x, float center_y, float radius)
+{
+	float x= bees.x[bee_index];
+	float y= bees.y[bee_index];
+	float facing= bees.facing[bee_index];
 
-	// update position and facing
-	x= wrap_value(x+speed*cos(facing)*k_dt, k_simulation_width, k_bee_radius);
-	y= wrap_value(y+speed*sin(facing)*k_dt, k_simulation_height, k_bee_radius);
-	if (edge_move)
+	bees.state[bee_index]= bees_t::_flying;
+	bees.timer[bee_index]= 0.0f;
+
+	if ((center_x-x)*(center_x-x) + (center_y-y)*(center_y-y)>radius*radius)
 	{
-		facing= wrap_value(0.2f*facing+spin, k_tau, 0.0f);
+		bees.speed[bee_index]= random.uniform(k_fly_speed_minimum, k_fly_speed_maximum);
+		float dr= atan2(center_y-y, center_x-x);
+		bees.spin[bee_index]= (dr-facing)/k_dt + random.uniform(0.0f, k_spin_maximum);
 	}
 	else
 	{
-		facing= wrap_value(facing+spin*k_dt, k_tau, 0.0f);
+		bees.speed[bee_index]= random.uniform(k_fly_speed_minimum, k_fly_speed_maximum);
+		float dr=  random.uniform(-0.4f*k_spin_maximum, 0.4f*k_spin_maximum);
+		bees.spin[bee_index]= dr;
 	}
 }
 
-void bee_t::palm_update(float center_x, float center_y, float radius)
+// buffers are allocated by reset(), once the config has been read
+swarm_t::swarm_t(): t(0.0), step(0), landed_max(0), parallel_active(true), flow_active(true), separation_active(false), steps_since_sort(0)
 {
-	state= _flying;
-	timer= 0.0f;
-
-	if ((center_x-x)*(center_x-x) + (center_y-y)*(center_y-y)>radius*radius)
+	for (int state= 0; state<bees_t::k_state_count; state++)
 	{
-		speed= uniform_random(k_fly_speed_minimum, k_fly_speed_maximum);
-		float dr= atan2(center_y-y, center_x-x);
-		spin= (dr-facing)/k_dt + uniform_random(0, k_spin_maximum);
+		state_fractions[state]= 0.0f;
 	}
-	else
+}
+
+void swarm_t::reset()
+{
+	bees.resize(g_config.bee_count);
+	for (int bee_index= 0; bee_index<bees.count; bee_index++)
 	{
-		speed= uniform_random(k_fly_speed_minimum, k_fly_speed_maximum);
-		float dr=  uniform_random(-0.4*k_spin_maximum, 0.4*k_spin_maximum);
-		spin= dr;
+		bee_spawn(bees, bee_index, random_stream(k_random_simulation_stream));
 	}
 
-	// update position and facing
-	x= wrap_value(x+speed*cos(facing)*k_dt, k_simulation_width, k_bee_radius);
-	y= wrap_value(y+speed*sin(facing)*k_dt, k_simulation_height, k_bee_radius);
-	facing= wrap_value(facing+spin*k_dt, k_tau, 0.0f);
+	step= 0;
+	landed_max= 0;
+	landed= cv::Mat::zeros(g_config.field_height, g_config.field_width, CV_8U);
+	flow_active= true;
+	parallel_active= true;
+	separation_active= false;
+	grid.initialize(k_separation_distance);
+	steps_since_sort= 0;
+	flow= cv::Mat::zeros(g_config.field_height, g_config.field_width, CV_32FC2);
+	uncovered= cv::Mat::zeros(g_config.field_height, g_config.field_width, CV_8U);
+	canvas.initialize(k_edge_height, k_edge_width);
+	force_seeds= cv::Mat::zeros(k_edge_height, k_edge_width, CV_8U);
+	force.initialize(k_edge_height, k_edge_width, k_edge_force_radius);
 }
 
-swarm_t::swarm_t(): bees(NULL)
+void swarm_t::update_landing(const edge_mask_t &edge_mask, int worker_count)
 {
-	reset();
+	landing_cells.resize(bees.count);
+	workers_run(worker_count, [&](int worker_index, int worker_count)
+	{
+		uint8_t *counts= landed_histograms[worker_index].ptr();
+		int begin, end;
+
+		landed_histograms[worker_index].setTo(0);
+		bee_slice(bees.count, worker_index, worker_count, begin, end);
+		for (int i= begin; i<end; i++)
+		{
+			landing_cells[i]= bee_edge_cell(bees, i, edge_mask, landed);
+			if (landing_cells[i]>=0) landed_claim(counts, landing_cells[i], UINT8_MAX);
+		}
+	});
+	resolve_landing(worker_count, landed_max);
+
+	workers_run(worker_count, [&](int worker_index, int worker_count)
+	{
+		uint8_t *counts= landed_histograms[worker_index].ptr();
+		random_t random;
+		int begin, end;
+
+		bee_slice(bees.count, worker_index, worker_count, begin, end);
+		for (int i= begin; i<end; i++)
+		{
+			if (i%k_slice_alignment==0) random= random_block_stream(step, i/k_slice_alignment);
+
+			bool landing= landing_cells[i]>=0 && landed_claim(counts, landing_cells[i], landed_max);
+
+			bee_update(bees, i, random, landing, flow_active? &flow : NULL);
+		}
+		bees.integrate(begin, end);
+	});
 }
 
-swarm_t::~swarm_t()
+void swarm_t::update_palm(const command_t &command, const edge_mask_t &edge_mask, int worker_count)
 {
-	delete bees;
+	float center_x= (command.bounding_box.x + 0.5f*command.bounding_box.width)/edge_mask.cols*g_config.simulation_width;
+	float center_y= (command.bounding_box.y + 0.5f*command.bounding_box.height)/edge_mask.rows*g_config.simulation_height;
+
+	float radius= static_cast<float>(command.bounding_box.width);
+
+	landed.setTo(0);
+
+	workers_run(worker_count, [&](int worker_index, int worker_count)
+	{
+		random_t random;
+		int begin, end;
+
+		bee_slice(bees.count, worker_index, worker_count, begin, end);
+		for (int i= begin; i<end; i++)
+		{
+			if (i%k_slice_alignment==0) random= random_block_stream(step, i/k_slice_alignment);
+			bee_palm_update(bees, i, random, center_x, center_y, radius);
+		}
+		bees.integrate(begin, end);
+	});
 }
 
-void swarm_t::reset()
+void swarm_t::update_draw(const command_t &command, const edge_mask_t &, int worker_count)
 {
-	if (bees) delete bees;
+	int center_x= (command.bounding_box.x + command.bounding_box.width/2);
+	int center_y= (command.bounding_box.y + command.bounding_box.height/2);
 
-	bees= new bee_t[k_bee_count];
+	draw_line(center_x, center_y);
+	update_force(canvas, landed);
 
-	landed_max= 0;
-	landed= cv::Mat::zeros(k_field_height, k_field_width, CV_8U);
-	flow_active= true;
-	flow= cv::Mat::zeros(k_field_height, k_field_width, CV_32F);
-	canvas= cv::Mat::zeros(k_edge_height, k_edge_width, CV_32F);
-	force= cv::Mat::zeros(k_edge_height, k_edge_width, CV_32FC2);
-	init_force(edge_force_radius);
+	landing_cells.resize(bees.count);
+	workers_run(worker_count, [&](int worker_index, int worker_count)
+	{
+		uint8_t *counts= landed_histograms[worker_index].ptr();
+		int begin, end;
+
+		landed_histograms[worker_index].setTo(0);
+		bee_slice(bees.count, worker_index, worker_count, begin, end);
+		for (int i= begin; i<end; i++)
+		{
+			landing_cells[i]= bee_canvas_cell(bees, i, canvas, landed);
+			if (landing_cells[i]>=0) landed_claim(counts, landing_cells[i], UINT8_MAX);
+		}
+	});
+	// every bee on a stroke counts toward landed, crowded or not
+	resolve_landing(worker_count, UINT8_MAX);
+
+	workers_run(worker_count, [&](int worker_index, int worker_count)
+	{
+		uint8_t *counts= landed_histograms[worker_index].ptr();
+		random_t random;
+		int begin, end;
+
+		bee_slice(bees.count, worker_index, worker_count, begin, end);
+		for (int i= begin; i<end; i++)
+		{
+			if (i%k_slice_alignment==0) random= random_block_stream(step, i/k_slice_alignment);
+
+			bool on_stroke= landing_cells[i]>=0;
+			bool room= on_stroke && landed_claim(counts, landing_cells[i], k_draw_landed_max);
+
+			bee_draw_update(bees, i, random, on_stroke, room, force.field);
+		}
+		bees.integrate(begin, end);
+	});
 }
 
-void swarm_t::init_force(int edge_force_radius)
-{	
-	int edge_diameter= 2*edge_force_radius+1;
-	//two filters that are used to calculate attraction/repulsion
-	edge_attract = cv::Mat::zeros(edge_diameter, edge_diameter, CV_32FC2);
-	for (int y=0; y<edge_diameter; y++)
+void swarm_t::update_flow(const edge_mask_t &edge_mask, const cv::Mat1i &edge_counts)
+{
+	// make an uncovered edge map
+	assert(landed.rows==flow.rows && landed.rows==edge_counts.rows);
+	assert(landed.cols==flow.cols && landed.cols==edge_counts.cols);
+	bool any_uncovered= false;
 	{
-		for (int x=0; x<edge_diameter; x++)
+		int edge_dx= edge_mask.cols/landed.cols;
+		int edge_dy= edge_mask.rows/landed.rows;
+
+		for (int y= 0; y<landed.rows; y++)
 		{
-			float norm= sqrt(static_cast<float>((edge_force_radius-y)*(edge_force_radius-y) + (edge_force_radius-x)*(edge_force_radius-x)));
-			if (norm==0.0f)
+			for (int x= 0; x<landed.cols; x++)
 			{
-				edge_attract(y, x)[0]= 0.0f; edge_attract(y, x)[1]= 0.0f;
+				int landed_count= landed(y, x);
+				int edge_count= edge_counts(y, x);
+				bool is_uncovered= landed_count*edge_dx*edge_dy<edge_count*landed_max/2;
+
+				uncovered(y, x)= is_uncovered ? 1 : 0;
+				any_uncovered= any_uncovered || is_uncovered;
 			}
-			else
+		}
+	}
+
+	// compute flow toward the closest uncovered edge
+	if (any_uncovered)
+	{
+		nearest_seed_transform(uncovered, nearest_uncovered_edge);
+
+		for (int y= 0; y<flow.rows; y++)
+		{
+			for (int x= 0; x<flow.cols; x++)
+			{
+				float dx= static_cast<float>(nearest_uncovered_edge(y, x)[0] - x);
+				float dy= static_cast<float>(nearest_uncovered_edge(y, x)[1] - y);
+				float length= std::sqrt(dx*dx + dy*dy);
+
+				flow(y, x)= length>0.0f ? cv::Vec2f(dx/length, dy/length) : cv::Vec2f(0.0f, 0.0f);
+			}
+		}
+	}
+	else
+	{
+		float x_mid= static_cast<float>(flow.cols/2);
+		float y_mid= static_cast<float>(flow.rows/2);
+
+		for (int y= 0; y<flow.rows; y++)
+		{
+			for (int x= 0; x<flow.cols; x++)
 			{
-				edge_attract(y, x)[0]= (edge_force_radius-y)/norm;
-				edge_attract(y, x)[1]= (edge_force_radius-x)/norm;
+				float dx= x - x_mid;
+				float dy= y - y_mid;
+				float length= std::sqrt(dx*dx + dy*dy);
+
+				flow(y, x)= length>0.0f ? cv::Vec2f(dx/length, dy/length) : cv::Vec2f(0.0f, 0.0f);
 			}
 		}
 	}
 }
 
-void swarm_t::apply_filter(const cv::Mat2f &filter, int y, int x, int radius)
+void swarm_t::resize(int bee_count)
 {
-	using namespace std;
-	y= min(max(0, y), force.rows);
-	x= min(max(0, x), force.cols);
-	int y_lower_limit= min(radius, y);						//how much can y decrease until out of bound or radius of the filter
-	int y_upper_limit= min(force.rows-y, radius);			//how much can y increase until out of bound or radius of the filter
-	int x_lower_limit= min(radius, x);						//how much can x decrease until out of bound or radius of the filter
-	int x_upper_limit= min(force.cols-x, radius);			//how much can x increase until out of bound or radius of the filter
-	for (int j= -y_lower_limit; j<y_upper_limit; j++)
-	{
-		for (int i= -x_lower_limit; i<x_upper_limit; i++)
+	int previous_count= bees.count;
+
+	// a random subset leaves, the end of the arrays is the bottom of the screen once the bees are sorted into grid order
+	if (bee_count<bees.count)
+	{
+		random_t &random= random_stream(k_random_simulation_stream);
+		std::vector<int> order(bees.count);
+
+		for (int bee_index= 0; bee_index<bees.count; bee_index++)
+		{
+			order[bee_index]= bee_index;
+		}
+		for (int remaining= bees.count; remaining>bee_count; remaining--)
 		{
-			force(y+j, x+i)[0]+= filter(radius+j, radius+i)[0];
-			force(y+j, x+i)[1]+= filter(radius+j, radius+i)[1];
+			std::swap(order[random.uniform(remaining)], order[remaining-1]);
 		}
+
+		// the bees that stay keep their grid order at the front
+		std::sort(order.begin(), order.begin()+bee_count);
+		bees.permute(order);
+	}
+
+	// new bees enter from the screen edge
+	bees.resize(bee_count);
+	for (int bee_index= previous_count; bee_index<bees.count; bee_index++)
+	{
+		bee_spawn(bees, bee_index, random_stream(k_random_simulation_stream));
 	}
 }
 
-void swarm_t::get_dir_mat_float(const cv::Mat1f &edge_frame, const cv::Mat2f &edge_attract, const cv::Mat1b &landed)
+void swarm_t::update_force(const canvas_t &canvas, const cv::Mat1b &landed)
 {
-	for (int j=0; j<edge_frame.rows; j+=2)
+	// every other stroke pixel that has no bees landed on its cell attracts
+	force_seeds.setTo(0);
+	for (int j=0; j<canvas.rows; j+=2)
 	{
-		int landed_j= j*landed.rows/edge_frame.rows;
+		int landed_j= j*landed.rows/canvas.rows;
 
-		for (int i=0; i<edge_frame.cols; i+=2)
+		for (int i=0; i<canvas.cols; i+=2)
 		{
-			int landed_i= i*landed.cols/edge_frame.cols;
+			int landed_i= i*landed.cols/canvas.cols;
 
-			if (edge_frame(j, i)>0.01f && landed(landed_j, landed_i)==0)
+			if (canvas.visible(j, i) && landed(landed_j, landed_i)==0)
 			{
-				apply_filter(edge_attract, j, i, edge_force_radius);
+				force_seeds(j, i)= 1;
 			}
 		}
 	}
+
+	force.update(force_seeds);
 }
 
-void swarm_t::update(const cv::Mat1b &edge_frame, const commands_t &commands)
+void swarm_t::update(const edge_mask_t &edge_mask, const cv::Mat1i &edge_counts, const commands_t &commands)
 {
-	bool gesture_driven= false;
-
 	t+= k_dt;
-	canvas*=0.99f;
-	int line_count= count_lines(canvas);
+	step++;
+	canvas.advance();
+	int line_count= canvas.visible_count();
 	if (line_count<last_count) {
 		last_draw_x=-1;
 		last_draw_y=-1;
@@ -342,197 +702,164 @@ void swarm_t::update(const cv::Mat1b &edge_frame, const commands_t &commands)
 
 	// compute landed_max
 	{
-		int edge_count= cv::countNonZero(edge_frame);
-		int landed_count= edge_count*landed.rows*landed.cols/(edge_frame.rows*edge_frame.cols);
-		landed_max= (landed_count>0 ? k_bee_count/landed_count : 0);
+		// in 64 bits, a dense edge frame times the cells of a fine field overflows an int
+		int64_t edge_count= static_cast<int64_t>(cv::sum(edge_counts)[0]);
+		int landed_count= static_cast<int>(edge_count*landed.rows*landed.cols/(edge_mask.rows*edge_mask.cols));
+		landed_max= (landed_count>0 ? bees.count/landed_count : 0);
 		if (landed_max<=0) landed_max= 1;
 		else if (landed_max>UINT8_MAX) landed_max= UINT8_MAX;
 	}
 
-	if (commands.size()>0)
+	// bee updates are split across the workers, each landing bees in its own histogram
+	int worker_count= parallel_active ? workers_count() : 1;
+	while (landed_histograms.size()<worker_count)
 	{
-		command_t current_sign= commands.at(0);
+		landed_histograms.push_back(cv::Mat1b::zeros(landed.rows, landed.cols));
+	}
 
-		if (current_sign.name=="palm")
+	// optionally spread out overlapping flying bees before the mode updates, s toggles it
+	if (separation_active)
+	{
+		grid.build(bees);
+		workers_run(worker_count, [&](int worker_index, int worker_count)
 		{
-			float center_x= (current_sign.bounding_box.x + 0.5f*current_sign.bounding_box.width)/edge_frame.cols*k_simulation_width;
-			float center_y= (current_sign.bounding_box.y + 0.5f*current_sign.bounding_box.height)/edge_frame.rows*k_simulation_height;
-
-			landed.setTo(0);
+			int begin, end;
 
-			for (int i= 0; i<k_bee_count; i++)
+			bee_slice(bees.count, worker_index, worker_count, begin, end);
+			for (int i= begin; i<end; i++)
 			{
-				bees[i].palm_update(center_x, center_y, static_cast<float>(current_sign.bounding_box.width));
+				bee_separate(bees, i, grid);
 			}
+		});
+	}
 
-			gesture_driven= true;
-		}
-		else if (current_sign.name=="peace")
-		{
-			int center_x= (current_sign.bounding_box.x + current_sign.bounding_box.width/2);
-			int center_y= (current_sign.bounding_box.y + current_sign.bounding_box.height/2);
-
-			draw_line(center_x, center_y);
-			force.setTo(0);
-			get_dir_mat_float(canvas, edge_attract, landed);
-			landed.setTo(0);
-
-			for (int i= 0; i<k_bee_count; i++)
-			{
-				bees[i].draw_update(canvas, 500, landed, force);
-			}
+	// the first command picks the behavior, bees land on edges when there is none for it
+	behavior_t behavior= commands.size()>0 && commands[0].gesture<k_gesture_count ? k_swarm_behaviors[commands[0].gesture] : NULL;
 
-			gesture_driven= true;
-		}
+	if (behavior)
+	{
+		(this->*behavior)(commands[0], edge_mask, worker_count);
 	}
-
-	if (!gesture_driven)
+	else
 	{
-		landed.setTo(0);
-
-		for (int i= 0; i<k_bee_count; i++)
-		{	
-			bees[i].update(edge_frame, landed_max, landed, flow_active? &flow : NULL);
-		}
+		update_landing(edge_mask, worker_count);
 	}
 
 	// compute flow for next update
 	if (flow_active)
 	{
-		struct point_t
-		{
-			int8_t x, y;
-
-			point_t(): x(0), y(0) {}
-			point_t(int i, int j): x(i), y(j) {}
-		};
-
-		struct element_t
-		{
-			uint16_t distance; // squared
-			point_t point;
-
-			element_t(): distance(0) {};
-			element_t(int x, int y, const point_t &np): point(x, y), distance((x-np.x)*(x-np.x)+(y-np.y)*(y-np.y)) {}
-			bool operator()(const element_t &a, const element_t &b) { return a.distance>b.distance; }
-		};
+		update_flow(edge_mask, edge_counts);
+	}
 
-		point_t nearest_uncovered_edge[k_field_height][k_field_width];
-		std::priority_queue<element_t, std::vector<element_t>, element_t> queue;
+	// keep bees in grid cell order, so neighboring bees read neighboring field cells
+	if (++steps_since_sort>=k_sort_period)
+	{
+		grid.build(bees);
+		bees.permute(grid.order);
+		steps_since_sort= 0;
+	}
 
-		memset(nearest_uncovered_edge, -1, sizeof(nearest_uncovered_edge));
+	// update state fractions
+	{
+		int state_counts[bees_t::k_state_count];
 
-		// make an uncovered edge map
-		assert(landed.rows==k_field_height);
-		assert(landed.cols==k_field_width);
+		for (int state= 0; state<bees_t::k_state_count; state++)
 		{
-			int edge_dx= edge_frame.cols/landed.cols;
-			int edge_dy= edge_frame.rows/landed.rows;
-
-			for (int y= 0; y<landed.rows; y++)
-			{
-				for (int x= 0; x<landed.cols; x++)
-				{
-					int landed_count= landed(y, x);
-					int edge_count= cv::countNonZero(edge_frame(cv::Rect(x*edge_dx, y*edge_dy, edge_dx, edge_dy)));
-
-					if (landed_count*edge_dx*edge_dy<edge_count*landed_max/2)
-					{
-						nearest_uncovered_edge[y][x]= point_t(x, y);
-						queue.push(element_t(x, y, nearest_uncovered_edge[y][x]));
-					}
-				}
-			}
+			state_counts[state]= 0;
 		}
 
-		// flood fill from uncovered edges to find closest uncovered edge
-		if (!queue.empty())
+		for (int bee_index= 0; bee_index<bees.count; bee_index++)
 		{
-			while (!queue.empty())
-			{
-				const int count= 4;
-				const int dx[count]={1, 0, -1, 0};
-				const int dy[count]={0, 1, 0, -1};
+			state_counts[bees.state[bee_index]]+= 1;
+		}
 
-				element_t element= queue.top();
+		for (int state= 0; state<bees_t::k_state_count; state++)
+		{
+			state_fractions[state]= static_cast<float>(state_counts[state])/bees.count;
+		}
+	}
+}
 
-				queue.pop();
+swarm_frame_t::swarm_frame_t(): time(0.0), t(0.0), landed_max(0), flow_active(false)
+{
+	for (int state= 0; state<bees_t::k_state_count; state++)
+	{
+		state_fractions[state]= 0.0f;
+	}
+}
 
-				for (int index= 0; index<count; index++)
-				{
-					int x= element.point.x + dx[index];
-					int y= element.point.y + dy[index];
-
-					if (x>=0 && x<k_field_width &&
-						y>=0 && y<k_field_height &&
-						nearest_uncovered_edge[y][x].x==-1 &&
-						nearest_uncovered_edge[y][x].y==-1)
-					{
-						nearest_uncovered_edge[y][x]= nearest_uncovered_edge[element.point.y][element.point.x];
-						queue.push(element_t(x, y, nearest_uncovered_edge[element.point.y][element.point.x]));
-					}
-				}
-			}
+// deep copy, frames are reused across threads so they must never share matrix data
+template <class source_t> static void swarm_frame_copy(swarm_frame_t &frame, const source_t &source)
+{
+	frame.t= source.t;
+	frame.bees.count= source.bees.count;
+	frame.bees.order_generation= source.bees.order_generation;
+	frame.bees.id= source.bees.id;
+	frame.bees.x= source.bees.x;
+	frame.bees.y= source.bees.y;
+	frame.bees.facing= source.bees.facing;
+	frame.bees.state= source.bees.state;
+	for (int state= 0; state<bees_t::k_state_count; state++)
+	{
+		frame.state_fractions[state]= source.state_fractions[state];
+	}
+	frame.landed_max= source.landed_max;
+	source.landed.copyTo(frame.landed);
+	frame.flow_active= source.flow_active;
+	source.flow.copyTo(frame.flow);
+}
 
-			// compute flow from closest uncovered edge
-			assert(flow.rows==k_field_height);
-			assert(flow.cols==k_field_width);
-			{
-				for (int y= 0; y<flow.rows; y++)
-				{
-					for (int x= 0; x<flow.cols; x++)
-					{
-						float dx= static_cast<float>(nearest_uncovered_edge[y][x].x - x);
-						float dy= static_cast<float>(nearest_uncovered_edge[y][x].y - y);
-
-						if (dx!=0.0f || dy!=0.0f)
-						{
-							flow(y, x)= atan2(dy, dx);
-						}
-					}
-				}
-			}
-		}
-		else
-		{
-			int x_mid= flow.cols/2;
-			int y_mid= flow.rows/2;
+void swarm_frame_t::capture(const swarm_t &swarm, double time)
+{
+	swarm_frame_copy(*this, swarm);
+	this->time= time;
+}
 
-			for (int y= 0; y<flow.rows; y++)
-			{
-				for (int x= 0; x<flow.cols; x++)
-				{
-					float dx= static_cast<float>(x - x_mid);
-					float dy= static_cast<float>(y - y_mid);
+void swarm_frame_t::interpolate(const swarm_frame_t &previous, const swarm_frame_t &current, float alpha)
+{
+	const float width_period= g_config.simulation_width+2.0f*k_bee_radius;
+	const float height_period= g_config.simulation_height+2.0f*k_bee_radius;
 
-					if (dx!=0.0f || dy!=0.0f)
-					{
-						flow(y, x)= atan2(dy, dx);
-					}
-				}
-			}
-		}
-	}
+	swarm_frame_copy(*this, current);
+	time= current.time;
+	if (previous.bees.count!=current.bees.count || previous.bees.order_generation!=current.bees.order_generation) return;
 
-	// update state fractions
+	time= previous.time + alpha*(current.time-previous.time);
+	t= previous.t + alpha*(current.t-previous.t);
+	for (int bee_index= 0; bee_index<bees.count; bee_index++)
 	{
-		int state_counts[bee_t::k_state_count];
+		float dx= current.bees.x[bee_index]-previous.bees.x[bee_index];
+		float dy= current.bees.y[bee_index]-previous.bees.y[bee_index];
+		float dfacing= current.bees.facing[bee_index]-previous.bees.facing[bee_index];
 
-		for (int state= 0; state<bee_t::k_state_count; state++)
+		// bees that wrapped around the screen edge snap to their new side
+		if (std::abs(dx)<0.5f*width_period && std::abs(dy)<0.5f*height_period)
 		{
-			state_counts[state]= 0;
+			bees.x[bee_index]= previous.bees.x[bee_index] + alpha*dx;
+			bees.y[bee_index]= previous.bees.y[bee_index] + alpha*dy;
 		}
 
-		for (int bee_index= 0; bee_index<k_bee_count; bee_index++)
-		{
-			state_counts[bees[bee_index].state]+= 1;
-		}
+		// turn the short way around
+		if (dfacing>0.5f*k_tau) dfacing-= k_tau;
+		else if (dfacing<-0.5f*k_tau) dfacing+= k_tau;
+		bees.facing[bee_index]= previous.bees.facing[bee_index] + alpha*dfacing;
+	}
+}
 
-		for (int state= 0; state<bee_t::k_state_count; state++)
-		{
-			state_fractions[state]= static_cast<float>(state_counts[state])/k_bee_count;
-		}
+void swarm_t::resolve_landing(int worker_count, int landed_cap)
+{
+	// exclusive prefix in worker order: each histogram turns into the candidates of the slices before it,
+	// so a bee lands exactly when it would have walking the bees in index order, whatever the worker count
+	landed.setTo(0);
+	for (int worker_index= 0; worker_index<worker_count; worker_index++)
+	{
+		cv::add(landed, landed_histograms[worker_index], landed_scratch);
+		landed.copyTo(landed_histograms[worker_index]);
+		std::swap(landed, landed_scratch);
 	}
+
+	// saturating counts, capped like the serial update that only counts the bees that land
+	cv::min(landed, landed_cap, landed);
 }
 
 void swarm_t::draw_line(int x, int y)
@@ -540,7 +867,7 @@ void swarm_t::draw_line(int x, int y)
 	//if it is the first point
 	if (last_draw_x==-1 && last_draw_y==-1)
 	{
-		canvas(y, x)= 1.0f;
+		canvas.draw(y, x);
 		last_draw_x= x;
 		last_draw_y= y;
 	}
@@ -561,7 +888,7 @@ void swarm_t::draw_line(int x, int y)
 			//iterate x, fill points on the canvas
 			for (int i= x_min; i<=x_max; i++)
 			{
-				canvas(static_cast<int>(m*i+b), i)= 1.0f;
+				canvas.draw(static_cast<int>(m*i+b), i);
 			}
 		}
 		else
@@ -575,7 +902,7 @@ void swarm_t::draw_line(int x, int y)
 			//iterate y, fill points on the canvas
 			for (int j= y_min; j<=y_max; j++)
 			{
-				canvas(j, static_cast<int>(m*j+b))= 1.0f;
+				canvas.draw(j, static_cast<int>(m*j+b));
 			}
 		}
 
@@ -583,19 +910,3 @@ void swarm_t::draw_line(int x, int y)
 		last_draw_y= y;
 	}
 }
-
-int swarm_t::count_lines(const cv::Mat1f &canvas)
-{
-	int count=0;
-	for (int j= 0; j<canvas.rows; j++) 
-	{
-		for (int i= 0; i<canvas.cols; i++)
-		{
-			if (canvas(j, i)>0.01f) 
-			{
-				count++;
-			}
-		}
-	}
-	return count;
-}
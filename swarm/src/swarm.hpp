@@ -1,65 +1,86 @@
 #ifndef swarm_hpp
 #define swarm_hpp
 
+#include <vector>
+
 #include <opencv2/core.hpp>
 
+#include "bees.hpp"
+#include "canvas.hpp"
+#include "force.hpp"
 #include "gesture.hpp"
-
-class bee_t
-{
-public:
-	enum state_t
-	{
-		_idle,
-		_crawling,
-		_flying,
-		k_state_count
-	};
-
-	bee_t();
-
-	void update(const cv::Mat1b &edge_frame, int landed_max, cv::Mat1b &landed, const cv::Mat1f *flow);
-	void palm_update(float center_x, float center_y, float radius);
-	void draw_update(const cv::Mat1f &edge_frame, int landed_max, cv::Mat1b &landed, const cv::Mat2f &force);
-
-	state_t state;
-	float timer;
-	float x, y;
-	float facing;
-	float speed;
-	float spin;
-};
+#include "grid.hpp"
+#include "mask.hpp"
 
 class swarm_t
 {
 public:
 	swarm_t();
-	~swarm_t();
 
 	void reset();
+	void resize(int bee_count); // grows or shrinks the swarm live, the other bees keep going
+
+	void update(const edge_mask_t &edge_mask, const cv::Mat1i &edge_counts, const commands_t &commands);
+
+	// one per gesture, dispatched through a table indexed by command_t::gesture
+	typedef void (swarm_t::*behavior_t)(const command_t &command, const edge_mask_t &edge_mask, int worker_count);
+	void update_palm(const command_t &command, const edge_mask_t &edge_mask, int worker_count);
+	void update_draw(const command_t &command, const edge_mask_t &edge_mask, int worker_count);
+	void update_landing(const edge_mask_t &edge_mask, int worker_count);
 
-	void update(const cv::Mat1b &edge_frame, const commands_t &commands);
 	void draw_line(int x, int y);
-	int count_lines(const cv::Mat1f &canvas);
 
-	void get_dir_mat_float(const cv::Mat1f &edge_frame, const cv::Mat2f &edge_attract, const cv::Mat1b &landed);
-	void apply_filter(const cv::Mat2f &force_field, int x, int y, int radius);
-	void init_force(int edge_force_size);
+	void update_flow(const edge_mask_t &edge_mask, const cv::Mat1i &edge_counts);
+	void update_force(const canvas_t &canvas, const cv::Mat1b &landed);
+	void resolve_landing(int worker_count, int landed_cap); // turns the worker histograms into per slice starting counts
 
 	double t;
-	bee_t *bees;
-	float state_fractions[bee_t::k_state_count]; // fraction of total bees in each state
+	int64_t step; // since reset, picks the random streams of the bee blocks
+	bees_t bees;
+	float state_fractions[bees_t::k_state_count]; // fraction of total bees in each state
 
 	int landed_max;
 	cv::Mat1b landed;
 
+	bool parallel_active;
+	std::vector<cv::Mat1b> landed_histograms; // one per worker, candidates per cell, then the count before the worker's slice
+	std::vector<int> landing_cells; // per bee, the landed cell under it or -1
+	cv::Mat1b landed_scratch;
+
 	bool flow_active;
-	cv::Mat1f flow;
+	cv::Mat2f flow; // unit vector (x, y) toward the nearest uncovered edge
+
+	bool separation_active;
+	grid_t grid;
+	int steps_since_sort;
+	cv::Mat1b uncovered;
+	cv::Mat2s nearest_uncovered_edge;
 
-	cv::Mat1f canvas;
+	canvas_t canvas;
+
+	cv::Mat1b force_seeds;
+	force_field_t force;
+};
 
-	cv::Mat2f force;
-	cv::Mat2f edge_attract;
+// what rendering and audio need of one simulation step, copied out so the simulation can keep running
+class swarm_frame_t
+{
+public:
+	swarm_frame_t();
+
+	void capture(const swarm_t &swarm, double time);
+	void interpolate(const swarm_frame_t &previous, const swarm_frame_t &current, float alpha);
+
+	double time; // simulation clock at the end of the step
+	double t;
+	bees_t bees; // id, position, facing and state only
+	float state_fractions[bees_t::k_state_count];
+
+	int landed_max;
+	cv::Mat1b landed;
+
+	bool flow_active;
+	cv::Mat2f flow;
 };
 
 #endif /* swarm_hpp */
@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cassert>
+
+#include <SDL_log.h>
+
+#include "tasks.hpp"
+#include "timer.hpp"
+#include "trace.hpp"
+
+task_graph_t::task_graph_t(): threads_run(false), remaining(0)
+{
+	reset_timings();
+}
+
+bool task_graph_t::initialize(int thread_count)
+{
+	threads_run= true;
+	for (int thread_index= 0; thread_index<thread_count; thread_index++)
+	{
+		threads.push_back(new std::thread(&task_graph_t::thread_function, this));
+	}
+
+	return true;
+}
+
+void task_graph_t::dispose()
+{
+	mutex.lock();
+	threads_run= false;
+	mutex.unlock();
+	changed.notify_all();
+
+	for (int thread_index= 0; thread_index<threads.size(); thread_index++)
+	{
+		threads[thread_index]->join();
+		delete threads[thread_index];
+	}
+	threads.clear();
+	tasks.clear();
+}
+
+int task_graph_t::add(const char *name, bool main, const task_function_t &function, const std::vector<int> &dependencies)
+{
+	int task_index= static_cast<int>(tasks.size());
+	task_t task;
+
+	// without threads everything runs on the caller
+	task.name= name;
+	task.main= main || threads.empty();
+	task.function= function;
+	task.dependency_count= static_cast<int>(dependencies.size());
+	task.pending= 0;
+	task.total_time= 0.0;
+	task.maximum_time= 0.0;
+	tasks.push_back(task);
+
+	for (int dependency_index= 0; dependency_index<dependencies.size(); dependency_index++)
+	{
+		assert(dependencies[dependency_index]>=0 && dependencies[dependency_index]<task_index);
+		tasks[dependencies[dependency_index]].dependents.push_back(task_index);
+	}
+
+	return task_index;
+}
+
+void task_graph_t::run()
+{
+	sdl_timer_t timer;
+	std::unique_lock<std::mutex> lock(mutex);
+
+	assert(remaining==0);
+	remaining= static_cast<int>(tasks.size());
+	for (int task_index= 0; task_index<tasks.size(); task_index++)
+	{
+		tasks[task_index].pending= tasks[task_index].dependency_count;
+		if (tasks[task_index].pending==0)
+		{
+			(tasks[task_index].main ? main_ready : thread_ready).push_back(task_index);
+		}
+	}
+	changed.notify_all();
+
+	while (remaining>0)
+	{
+		changed.wait(lock, [&]{ return remaining==0 || !main_ready.empty(); });
+
+		if (!main_ready.empty())
+		{
+			int task_index= main_ready.front();
+
+			main_ready.pop_front();
+			execute(task_index, lock);
+		}
+	}
+
+	double time= timer.elapsed();
+	run_count++;
+	run_total_time+= time;
+	run_maximum_time= std::max(run_maximum_time, time);
+}
+
+void task_graph_t::thread_function()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	trace_thread("frame graph");
+
+	while (true)
+	{
+		changed.wait(lock, [&]{ return !threads_run || !thread_ready.empty(); });
+
+		if (!threads_run) break;
+
+		int task_index= thread_ready.front();
+
+		thread_ready.pop_front();
+		execute(task_index, lock);
+	}
+}
+
+// runs the task unlocked, then releases its dependents
+void task_graph_t::execute(int task_index, std::unique_lock<std::mutex> &lock)
+{
+	task_t &task= tasks[task_index];
+	sdl_timer_t timer;
+
+	lock.unlock();
+	trace_begin(task.name);
+	task.function();
+	trace_end(task.name);
+	double time= timer.elapsed();
+	lock.lock();
+
+	task.total_time+= time;
+	task.maximum_time= std::max(task.maximum_time, time);
+
+	for (int dependent_index= 0; dependent_index<task.dependents.size(); dependent_index++)
+	{
+		task_t &dependent= tasks[task.dependents[dependent_index]];
+
+		if (--dependent.pending==0)
+		{
+			(dependent.main ? main_ready : thread_ready).push_back(task.dependents[dependent_index]);
+		}
+	}
+	remaining--;
+	changed.notify_all();
+}
+
+void task_graph_t::log_timings()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (run_count==0) return;
+
+	for (int task_index= 0; task_index<tasks.size(); task_index++)
+	{
+		const task_t &task= tasks[task_index];
+
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Stage %-8s %6.2f ms average, %6.2f ms worst%s", task.name,
+			1000.0*task.total_time/run_count, 1000.0*task.maximum_time, task.main ? "" : ", off the main thread");
+	}
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Frame graph %6.2f ms average, %6.2f ms worst over %d frames",
+		1000.0*run_total_time/run_count, 1000.0*run_maximum_time, run_count);
+}
+
+void task_graph_t::reset_timings()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (int task_index= 0; task_index<tasks.size(); task_index++)
+	{
+		tasks[task_index].total_time= 0.0;
+		tasks[task_index].maximum_time= 0.0;
+	}
+	run_count= 0;
+	run_total_time= 0.0;
+	run_maximum_time= 0.0;
+}
@@ -0,0 +1,61 @@
+#ifndef tasks_hpp
+#define tasks_hpp
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef std::function<void()> task_function_t;
+
+// a fixed graph of named tasks, run as a whole once per frame. a task starts as soon as the tasks
+// it depends on are done, main tasks on the thread calling run and the rest on the graph's own threads
+class task_graph_t
+{
+public:
+	task_graph_t();
+
+	bool initialize(int thread_count);
+	void dispose();
+
+	// dependencies must already be in the graph, so the graph can't have cycles
+	int add(const char *name, bool main, const task_function_t &function, const std::vector<int> &dependencies= std::vector<int>());
+
+	// returns when every task has run
+	void run();
+
+	// per task average and worst time since the last reset, plus the whole run
+	void log_timings();
+	void reset_timings();
+
+private:
+	struct task_t
+	{
+		const char *name; // kept as is for the trace, a literal
+		bool main;
+		task_function_t function;
+		std::vector<int> dependents;
+		int dependency_count;
+		int pending; // dependencies not done yet this run
+		double total_time, maximum_time;
+	};
+
+	void thread_function();
+	void execute(int task_index, std::unique_lock<std::mutex> &lock);
+
+	std::vector<task_t> tasks;
+	std::vector<std::thread *> threads;
+	bool threads_run;
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<int> main_ready, thread_ready;
+	int remaining; // tasks not done yet this run
+
+	int run_count;
+	double run_total_time, run_maximum_time;
+};
+
+#endif /* tasks_hpp */
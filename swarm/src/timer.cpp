@@ -1,27 +1,32 @@
 #include "timer.hpp"
 
-timer_t::timer_t()
+sdl_timer_t::sdl_timer_t()
 {
 	frequency= static_cast<double>(SDL_GetPerformanceFrequency());
 	reset();
 }
 
-void timer_t::reset()
+void sdl_timer_t::reset()
 {
 	counter= SDL_GetPerformanceCounter();
 }
 
-bool timer_t::passed(double time)
+bool sdl_timer_t::passed(double time)
 {
 	return (SDL_GetPerformanceCounter()-counter)/frequency>time;
 }
 
-void timer_t::start(double time)
+double sdl_timer_t::elapsed()
+{
+	return (SDL_GetPerformanceCounter()-counter)/frequency;
+}
+
+void sdl_timer_t::start(double time)
 {
 	counter= SDL_GetPerformanceCounter() + static_cast<uint64_t>(time*frequency);
 }
 
-bool timer_t::running()
+bool sdl_timer_t::running()
 {
 	return SDL_GetPerformanceCounter()<counter;
 }
@@ -3,14 +3,16 @@
 
 #include <SDL_timer.h>
 
-class timer_t
+// seconds on the SDL performance counter, not timer_t since glibc and POSIX already define one
+class sdl_timer_t
 {
 public:
-	timer_t();
+	sdl_timer_t();
 
 	// stopwatch
 	void reset();
 	bool passed(double time);
+	double elapsed(); // seconds since reset
 
 	// countdown
 	void start(double time);
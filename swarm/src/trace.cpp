@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include <SDL_log.h>
+#include <SDL_timer.h>
+
+#include "trace.hpp"
+
+static const int k_trace_ring_size= 16384; // events per thread, a power of two
+
+struct trace_record_t
+{
+	uint64_t counter;
+	const char *name;
+	int64_t value;
+	int type;
+};
+
+// written by its thread only, the dump reads it from outside and drops whatever was overwritten meanwhile
+struct trace_ring_t
+{
+	const char *thread_name;
+	int thread_index;
+	bool alive; // false once its thread exits, then the ring goes to the next new thread
+	bool dumped; // dumped since its thread exited, later dumps skip it
+	std::atomic<uint64_t> head; // records ever written
+	trace_record_t records[k_trace_ring_size];
+};
+
+// releases the thread's ring when the thread exits, only constructed on the slow path so events skip its guard
+struct trace_thread_t
+{
+	~trace_thread_t();
+};
+
+static trace_ring_t *trace_ring();
+
+// rings are created on a thread's first event and recycled once their thread exits, so threads
+// that come and go, like the gesture thread when detection is toggled, don't grow the list
+static std::mutex g_trace_mutex;
+static std::vector<trace_ring_t *> g_trace_rings;
+static int g_trace_thread_count= 0;
+static thread_local trace_ring_t *g_trace_ring= NULL;
+static thread_local trace_thread_t g_trace_thread;
+
+static trace_ring_t *trace_ring()
+{
+	if (!g_trace_ring)
+	{
+		std::lock_guard<std::mutex> lock(g_trace_mutex);
+
+		for (int ring_index= 0; ring_index<g_trace_rings.size() && !g_trace_ring; ring_index++)
+		{
+			if (!g_trace_rings[ring_index]->alive) g_trace_ring= g_trace_rings[ring_index];
+		}
+		if (!g_trace_ring)
+		{
+			g_trace_ring= new trace_ring_t;
+			g_trace_rings.push_back(g_trace_ring);
+		}
+
+		g_trace_ring->thread_name= NULL;
+		g_trace_ring->thread_index= g_trace_thread_count++;
+		g_trace_ring->alive= true;
+		g_trace_ring->dumped= false;
+		g_trace_ring->head.store(0);
+		(void)&g_trace_thread; // first use constructs it, its destructor runs when this thread exits
+	}
+
+	return g_trace_ring;
+}
+
+trace_thread_t::~trace_thread_t()
+{
+	if (g_trace_ring)
+	{
+		std::lock_guard<std::mutex> lock(g_trace_mutex);
+
+		g_trace_ring->alive= false;
+		g_trace_ring= NULL;
+	}
+}
+
+void trace_thread(const char *name)
+{
+	trace_ring()->thread_name= name;
+}
+
+void trace_event(trace_type_t type, const char *name, int64_t value)
+{
+	trace_ring_t *ring= trace_ring();
+	uint64_t head= ring->head.load(std::memory_order_relaxed);
+	trace_record_t &record= ring->records[head&(k_trace_ring_size-1)];
+
+	record.counter= SDL_GetPerformanceCounter();
+	record.name= name;
+	record.value= value;
+	record.type= type;
+	ring->head.store(head+1, std::memory_order_release);
+}
+
+bool trace_dump(const char *filepath)
+{
+	static const char k_phases[]= {'B', 'E', 'i'};
+	double microseconds_per_count= 1e6/SDL_GetPerformanceFrequency();
+	std::vector<trace_record_t> records;
+	bool first= true;
+	FILE *file= std::fopen(filepath, "w");
+
+	if (!file)
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't write trace %s", filepath);
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(g_trace_mutex);
+
+	std::fprintf(file, "{\"traceEvents\": [\n");
+	for (int ring_index= 0; ring_index<g_trace_rings.size(); ring_index++)
+	{
+		trace_ring_t *ring= g_trace_rings[ring_index];
+
+		// a dead thread's last events go in one dump, after that its ring only waits to be reused
+		if (!ring->alive && ring->dumped) continue;
+		ring->dumped= !ring->alive;
+
+		uint64_t head= ring->head.load(std::memory_order_acquire);
+		uint64_t begin= head>k_trace_ring_size ? head-k_trace_ring_size : 0;
+
+		records.clear();
+		for (uint64_t index= begin; index<head; index++)
+		{
+			records.push_back(ring->records[index&(k_trace_ring_size-1)]);
+		}
+
+		// the thread kept going while we copied, its newest records may have replaced the oldest copied ones
+		uint64_t new_head= ring->head.load(std::memory_order_acquire);
+		uint64_t valid_begin= new_head+1>k_trace_ring_size ? new_head+1-k_trace_ring_size : 0; // +1 for a record being written
+		int skip= valid_begin>begin ? static_cast<int>(std::min<uint64_t>(valid_begin-begin, records.size())) : 0;
+
+		if (ring->thread_name)
+		{
+			std::fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+				first ? "" : ",\n", ring->thread_index, ring->thread_name);
+			first= false;
+		}
+
+		for (int record_index= skip; record_index<records.size(); record_index++)
+		{
+			const trace_record_t &record= records[record_index];
+
+			std::fprintf(file, "%s{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": %d",
+				first ? "" : ",\n", record.name, k_phases[record.type], record.counter*microseconds_per_count, ring->thread_index);
+			if (record.type==_trace_instant)
+			{
+				std::fprintf(file, ", \"s\": \"t\", \"args\": {\"value\": %lld}", static_cast<long long>(record.value));
+			}
+			std::fprintf(file, "}");
+			first= false;
+		}
+	}
+	std::fprintf(file, "\n]}\n");
+
+	bool success= std::ferror(file)==0;
+	std::fclose(file);
+
+	if (success)
+	{
+		SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Wrote trace %s", filepath);
+	}
+	else
+	{
+		SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "Couldn't write trace %s", filepath);
+	}
+
+	return success;
+}
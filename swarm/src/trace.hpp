@@ -0,0 +1,27 @@
+#ifndef trace_hpp
+#define trace_hpp
+
+#include <cstdint>
+
+enum trace_type_t
+{
+	_trace_begin,
+	_trace_end,
+	_trace_instant
+};
+
+// names the calling thread in the dump, call once when the thread starts
+void trace_thread(const char *name);
+
+// appends a timestamped event to the calling thread's ring, no locks and no formatting.
+// name is kept as a pointer, so it has to be a literal or live as long as the program
+void trace_event(trace_type_t type, const char *name, int64_t value= 0);
+
+inline void trace_begin(const char *name) { trace_event(_trace_begin, name); }
+inline void trace_end(const char *name) { trace_event(_trace_end, name); }
+inline void trace_instant(const char *name, int64_t value= 0) { trace_event(_trace_instant, name, value); }
+
+// writes the events still in every ring as chrome://tracing json
+bool trace_dump(const char *filepath);
+
+#endif /* trace_hpp */
@@ -0,0 +1,81 @@
+#include <opencv2/imgproc.hpp>
+
+#include "tracker.hpp"
+
+const int k_tracker_scale= 2; // match on a half resolution gray frame
+const int k_tracker_minimum_size= 8; // small frame pixels, smaller patches match anything
+const float k_tracker_search= 0.5f; // of the box size, how far a hand may move between frames
+const double k_tracker_minimum_score= 0.6; // normalized correlation, below it the hand is lost
+
+void tracker_t::start(const cv::Mat3b &frame, const commands_t &commands)
+{
+	targets.clear();
+	if (commands.empty()) return;
+
+	shrink(frame);
+	for (int command_index= 0; command_index<commands.size(); command_index++)
+	{
+		const cv::Rect &bounding_box= commands[command_index].bounding_box;
+		target_t target;
+
+		target.command= commands[command_index];
+		target.origin= cv::Rect(bounding_box.x/k_tracker_scale, bounding_box.y/k_tracker_scale, bounding_box.width/k_tracker_scale, bounding_box.height/k_tracker_scale) &
+			cv::Rect(0, 0, small_frame.cols, small_frame.rows);
+		target.box= target.origin;
+
+		// one hand we can't follow means the detector has to run again next frame
+		if (target.origin.width<k_tracker_minimum_size || target.origin.height<k_tracker_minimum_size)
+		{
+			targets.clear();
+			return;
+		}
+
+		target.patch= small_frame(target.origin).clone();
+		targets.push_back(target);
+	}
+}
+
+bool tracker_t::update(const cv::Mat3b &frame, commands_t &commands)
+{
+	commands.clear();
+	if (targets.empty()) return false;
+
+	shrink(frame);
+	for (int target_index= 0; target_index<targets.size(); target_index++)
+	{
+		target_t &target= targets[target_index];
+		int margin_x= static_cast<int>(k_tracker_search*target.box.width);
+		int margin_y= static_cast<int>(k_tracker_search*target.box.height);
+		cv::Rect window= cv::Rect(target.box.x-margin_x, target.box.y-margin_y, target.box.width+2*margin_x, target.box.height+2*margin_y) &
+			cv::Rect(0, 0, small_frame.cols, small_frame.rows);
+		cv::Point location;
+		double score;
+
+		// the window always holds the box, which never leaves the frame
+		cv::matchTemplate(small_frame(window), target.patch, scores, cv::TM_CCOEFF_NORMED);
+		cv::minMaxLoc(scores, NULL, &score, NULL, &location);
+		if (score<k_tracker_minimum_score)
+		{
+			commands.clear();
+			targets.clear();
+			return false;
+		}
+
+		target.box.x= window.x+location.x;
+		target.box.y= window.y+location.y;
+
+		command_t command= target.command;
+		command.bounding_box.x+= (target.box.x-target.origin.x)*k_tracker_scale;
+		command.bounding_box.y+= (target.box.y-target.origin.y)*k_tracker_scale;
+		command.confidence*= static_cast<float>(score);
+		commands.push_back(command);
+	}
+
+	return true;
+}
+
+void tracker_t::shrink(const cv::Mat3b &frame)
+{
+	cv::cvtColor(frame, gray_frame, cv::COLOR_BGR2GRAY);
+	cv::resize(gray_frame, small_frame, cv::Size(frame.cols/k_tracker_scale, frame.rows/k_tracker_scale), 0, 0, cv::INTER_AREA);
+}
@@ -0,0 +1,32 @@
+#ifndef tracker_hpp
+#define tracker_hpp
+
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "gesture.hpp"
+
+// follows detected hands between detector runs by matching each one's patch in a window around where it was
+class tracker_t
+{
+public:
+	void start(const cv::Mat3b &frame, const commands_t &commands); // commands from the detector on this frame
+	bool update(const cv::Mat3b &frame, commands_t &commands); // false when there is nothing to track or a hand is lost
+
+private:
+	struct target_t
+	{
+		command_t command; // as detected
+		cv::Rect origin, box; // tracked rect in the small frame, where it started and where it is now
+		cv::Mat1b patch;
+	};
+
+	void shrink(const cv::Mat3b &frame);
+
+	std::vector<target_t> targets;
+	cv::Mat1b gray_frame, small_frame;
+	cv::Mat1f scores;
+};
+
+#endif /* tracker_hpp */
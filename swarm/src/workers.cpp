@@ -0,0 +1,115 @@
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <SDL_log.h>
+
+#include "constants.hpp"
+#include "workers.hpp"
+
+static void worker_thread_function(int worker_index, int generation);
+
+static bool g_worker_thread_run= false;
+static std::vector<std::thread *> g_worker_threads;
+
+static std::mutex g_worker_mutex;
+static std::condition_variable g_worker_start;
+static std::condition_variable g_worker_finish;
+static const worker_job_t *g_worker_job= NULL;
+static int g_worker_job_count= 0;
+static int g_worker_generation= 0;
+static int g_worker_pending= 0;
+
+bool workers_initialize()
+{
+	int worker_count= static_cast<int>(std::thread::hardware_concurrency());
+
+	if (worker_count<1) worker_count= 1;
+	else if (worker_count>k_worker_maximum) worker_count= k_worker_maximum;
+
+	g_worker_thread_run= true;
+	for (int worker_index= 1; worker_index<worker_count; worker_index++)
+	{
+		g_worker_threads.push_back(new std::thread(worker_thread_function, worker_index, g_worker_generation));
+	}
+
+	SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Started %d worker threads", worker_count);
+
+	return true;
+}
+
+void workers_dispose()
+{
+	g_worker_mutex.lock();
+	g_worker_thread_run= false;
+	g_worker_mutex.unlock();
+	g_worker_start.notify_all();
+
+	for (int thread_index= 0; thread_index<g_worker_threads.size(); thread_index++)
+	{
+		g_worker_threads[thread_index]->join();
+		delete g_worker_threads[thread_index];
+	}
+	g_worker_threads.clear();
+}
+
+int workers_count()
+{
+	return static_cast<int>(g_worker_threads.size())+1;
+}
+
+void workers_run(int worker_count, const worker_job_t &job)
+{
+	if (worker_count>workers_count()) worker_count= workers_count();
+
+	if (worker_count>1)
+	{
+		g_worker_mutex.lock();
+		g_worker_job= &job;
+		g_worker_job_count= worker_count;
+		g_worker_pending= worker_count-1;
+		g_worker_generation++;
+		g_worker_mutex.unlock();
+		g_worker_start.notify_all();
+
+		job(0, worker_count);
+
+		std::unique_lock<std::mutex> lock(g_worker_mutex);
+		g_worker_finish.wait(lock, []{ return g_worker_pending==0; });
+		g_worker_job= NULL;
+	}
+	else
+	{
+		job(0, 1);
+	}
+}
+
+static void worker_thread_function(int worker_index, int generation)
+{
+	std::unique_lock<std::mutex> lock(g_worker_mutex);
+
+	while (true)
+	{
+		g_worker_start.wait(lock, [&]{ return !g_worker_thread_run || g_worker_generation!=generation; });
+
+		if (!g_worker_thread_run) break;
+
+		generation= g_worker_generation;
+
+		if (worker_index<g_worker_job_count)
+		{
+			const worker_job_t *job= g_worker_job;
+			int worker_count= g_worker_job_count;
+
+			lock.unlock();
+			(*job)(worker_index, worker_count);
+			lock.lock();
+
+			if (--g_worker_pending==0)
+			{
+				g_worker_finish.notify_one();
+			}
+		}
+	}
+}
@@ -0,0 +1,17 @@
+#ifndef workers_hpp
+#define workers_hpp
+
+#include <functional>
+
+typedef std::function<void(int worker_index, int worker_count)> worker_job_t;
+
+bool workers_initialize();
+void workers_dispose();
+
+// number of workers available to workers_run, including the calling thread
+int workers_count();
+
+// runs job once per worker on [0, worker_count) and returns when all are done, worker 0 is the calling thread
+void workers_run(int worker_count, const worker_job_t &job);
+
+#endif /* workers_hpp */